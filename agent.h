@@ -0,0 +1,66 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <vector>
+
+// Step interface shared by the agents. An agent never touches cin/cout: the
+// caller passes in what Frodo sees after each action and gets the next action
+// back, so the same agent runs behind the wire protocol (protocol.h) or inside
+// the tester.
+//
+//     agent.start(variant, gollum_x, gollum_y);
+//     Action a = agent.step(first_observation);
+//     while (a.type != ACT_END) { ...perform a...; a = agent.step(observation); }
+
+struct Percept { int x; int y; char t; }; // one perceived cell: enemy, item or 'P' (lethal)
+
+// everything the environment reports after an action
+struct Observation {
+    std::vector<Percept> percepts;
+    bool has_mount = false;           // Gollum revealed Mount Doom with this observation
+    int mount_x = -1, mount_y = -1;
+};
+
+enum ActionType { ACT_MOVE, ACT_RING_ON, ACT_RING_OFF, ACT_END };
+
+struct Action {
+    ActionType type;
+    int x, y;  // ACT_MOVE target
+    int cost;  // ACT_END: path length, -1 when the map is unsolvable
+};
+
+// Work counters of one episode. Agents always count, since each counter is a plain
+// increment; only writing them out (--counters) costs anything.
+struct AgentCounters {
+    long long nodes_expanded = 0;        // planner states expanded
+    long long nodes_reexpanded = 0;      // of those, states expanded again within the same search
+    long long is_dangerous_calls = 0;
+    long long replans = 0;               // planner runs while walking
+    long long exploration_fallbacks = 0; // exploration steps or routes chosen because no path was found
+    long long search_calls = 0;          // backtracking search() runs, the final report included
+    long long bound_prunes = 0;          // backtracking paths cut by the length bound
+    long long memo_prunes = 0;           // backtracking paths cut by the best-distance memo
+    long long round_trips = 0;           // actions answered by an observation
+    long long bytes_read = 0;            // protocol bytes received (agent binaries only)
+};
+
+// field names for the stderr record and the tester's totals
+struct CounterField { const char* name; long long AgentCounters::*member; };
+const CounterField COUNTER_FIELDS[] = {
+    {"nodes_expanded", &AgentCounters::nodes_expanded},
+    {"nodes_reexpanded", &AgentCounters::nodes_reexpanded},
+    {"is_dangerous_calls", &AgentCounters::is_dangerous_calls},
+    {"replans", &AgentCounters::replans},
+    {"exploration_fallbacks", &AgentCounters::exploration_fallbacks},
+    {"search_calls", &AgentCounters::search_calls},
+    {"bound_prunes", &AgentCounters::bound_prunes},
+    {"memo_prunes", &AgentCounters::memo_prunes},
+    {"round_trips", &AgentCounters::round_trips},
+    {"bytes_read", &AgentCounters::bytes_read},
+};
+
+inline Action move_action(int x, int y) { return {ACT_MOVE, x, y, 0}; }
+inline Action ring_action(bool turn_on) { return {turn_on ? ACT_RING_ON : ACT_RING_OFF, -1, -1, 0}; }
+inline Action end_action(int cost) { return {ACT_END, -1, -1, cost}; }
+
+#endif
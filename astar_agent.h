@@ -0,0 +1,1419 @@
+#ifndef ASTAR_AGENT_H
+#define ASTAR_AGENT_H
+
+#include <vector>
+#include <queue>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include "agent.h"
+#include "grid.h"
+#include "bitboard.h"
+using namespace std;
+
+// map symbols
+const char ORC = 'O';
+const char URUK = 'U';
+const char NAZGUL = 'N';
+const char WATCH = 'W';
+const char PERCEP = 'P';
+const char RING = 'R';
+const char MITHRIL = 'C';
+const char GOLLUM = 'G';
+const char MOUNT = 'M';
+
+struct Step { char action; int x; int y; }; // plan step: 'M' move, 'R' ring on, 'O' ring off
+struct OpenNode { int x; int y; int r; int m; }; // open list entry
+
+// planners behind next_action(); D* Lite unless the binary is told otherwise
+enum Planner { PLAN_DSTAR, PLAN_ASTAR, PLAN_JPS, PLAN_HPA, PLAN_HDA };
+
+// zone radius of an enemy under given ring/mithril state
+inline int enemy_range(char enemy, bool ring, bool mithril) {
+    if (enemy == ORC) return (mithril || ring) ? 0 : 1;
+    if (enemy == URUK) return (mithril || ring) ? 1 : 2;
+    if (enemy == NAZGUL) return ring ? 2 : 1;
+    if (enemy == WATCH) return ring ? 3 : 2;
+    return -1;
+}
+
+// D* Lite costs are 64-bit: moves are scaled by the number of states (see ds_move)
+typedef long long ds_cost;
+const ds_cost DS_INF = (ds_cost)1 << 60;
+typedef pair<pair<ds_cost,ds_cost>,int> ds_entry;
+
+// HPA* clusters are HPA_CLUSTER cells square; a border run of open cells at least
+// HPA_LONG_RUN long gets a transition at both ends instead of one in the middle
+const int HPA_CLUSTER = 16;
+const int HPA_LONG_RUN = 6;
+const int HPA_INF = 1000000000;
+
+struct HpaCluster {
+    bool built = false;                     // entrances and edges match the agent's map
+    vector<int> entrances;                  // cells, x * size + y
+    vector<vector<int>> partners;           // [entrance]: cells across the border
+    vector<vector<pair<int,int>>> edges;    // [entrance * 4 + layer]: (moves, state_id)
+};
+
+// HDA*: a state belongs to the thread its 4x4 block hashes to, so most moves stay
+// with one thread. States for other threads collect in the sender's outbox and are
+// appended in batches to the owner's inbox; a thread with nothing to do sleeps on it
+const int HDA_BLOCK_SHIFT = 2;
+const int HDA_BATCH = 64;              // expansions between looks at the inbox, and outbox size that forces a flush
+const int HDA_MAX_DEFAULT_THREADS = 16; // cap of the one-per-core default
+const int HDA_WAIT_US = 50;            // longest nap of a thread whose cheapest state waits for other threads'
+
+struct HdaMessage { long long g; int state; int parent; char action; };
+
+// many producers, one consumer
+struct HdaInbox {
+    mutex lock;
+    condition_variable wake;
+    vector<HdaMessage> messages;
+    bool sleeping = false;             // the owner waits on wake
+    alignas(64) atomic<long long> lowest{0}; // f at the top of the owner's open list
+
+    // append a sender's batch and empty it
+    void post(vector<HdaMessage>& batch) {
+        bool notify;
+        {
+            lock_guard<mutex> guard(lock);
+            messages.insert(messages.end(), batch.begin(), batch.end());
+            notify = sleeping;
+        }
+        batch.clear();
+        if (notify) wake.notify_one();
+    }
+
+    // move every waiting message into the empty `batch`
+    bool take(vector<HdaMessage>& batch) {
+        lock_guard<mutex> guard(lock);
+        swap(messages, batch);
+        return !batch.empty();
+    }
+
+    // sleep until a message arrives or the search is over, at most HDA_WAIT_US if `nap`
+    void wait(const atomic<bool>& done, bool nap) {
+        unique_lock<mutex> guard(lock);
+        sleeping = true;
+        auto ready = [&] { return !messages.empty() || done.load(); };
+        if (nap) wake.wait_for(guard, chrono::microseconds(HDA_WAIT_US), ready);
+        else wake.wait(guard, ready);
+        sleeping = false;
+    }
+
+    // after setting done; taking the lock makes sure a thread about to sleep sees it
+    void wake_up() {
+        lock_guard<mutex> guard(lock);
+        wake.notify_one();
+    }
+};
+
+// Threads 1..size-1 for hda_plan, started once and parked on a condition variable
+// between plans; run() hands them the job, takes part as thread 0 and waits for all
+struct HdaPool {
+    mutex lock;
+    condition_variable wake, finished;
+    const function<void(int)>* job = nullptr;
+    unsigned generation = 0;
+    int running = 0;
+    bool stop = false;
+    vector<thread> workers;
+
+    explicit HdaPool(int threads) {
+        for (int t = 1; t < threads; t++) workers.emplace_back([this, t] { park(t); });
+    }
+
+    ~HdaPool() {
+        { lock_guard<mutex> guard(lock); stop = true; }
+        wake.notify_all();
+        for (thread& t : workers) t.join();
+    }
+
+    int size() const { return (int)workers.size() + 1; }
+
+    void run(const function<void(int)>& task) {
+        { lock_guard<mutex> guard(lock); job = &task; running = (int)workers.size(); generation++; }
+        wake.notify_all();
+        task(0);
+        unique_lock<mutex> guard(lock);
+        finished.wait(guard, [this] { return running == 0; });
+        job = nullptr;
+    }
+
+    void park(int me) {
+        unsigned seen = 0;
+        while (true) {
+            const function<void(int)>* task;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+                task = job;
+            }
+            (*task)(me);
+            lock_guard<mutex> guard(lock);
+            if (--running == 0) finished.notify_one();
+        }
+    }
+};
+
+// whole agent for an N x N map; N == 0 means the size is only known at runtime
+template <int N>
+struct AstarAgent {
+    int grid_size;
+    Planner planner = PLAN_DSTAR;
+    int hda_threads = 0;                // PLAN_HDA worker threads, 0: one per core
+    bool use_true_distance = false;     // find_path heuristic: BFS distances instead of manhattan
+    bool use_frontier = true;           // no path: walk to the best frontier cell, not one greedy step
+
+    int variant_number = 1;
+    int perception_range = 1;
+    int goal_x = -1, goal_y = -1;
+    int mount_x = -1, mount_y = -1;
+    bool knows_mount = false;
+
+    // world model as bitboards: one bit per cell and layer
+    Bitboard<N> dangerous;               // cells reported lethal ('P') or holding an enemy
+    Bitboard<N> seen_cells;
+    Bitboard<N> enemies;                 // cells holding an enemy of any type
+    Bitboard<N> mithril_cells;           // item layer
+    Bitboard<N> danger_layer[4];         // [ring * 2 + mithril]: dangerous cells plus known enemy zones
+    vector<pair<int,int>> changed_cells; // cells whose safety or mithril flag changed since the last replan
+    int world_version = 0;               // bumped whenever update_world() adds to changed_cells
+    int mithril_found = 0;               // mithril cells seen so far
+
+    int current_x = 0, current_y = 0;
+    bool ring_active = false;
+    bool has_mithril = false;
+    int move_count = 0;
+
+    // step() state: the plan being executed and the action waiting for its observation
+    vector<Step> plan;
+    int plan_pos = 0;
+    bool in_plan = false;       // executing plan[plan_pos]
+    bool step_done = false;     // plan[plan_pos] has been carried out
+    bool started = false;
+    bool exploring = false;     // the plan is an exploration route, valid until new mithril shows up
+    int explore_mithril = 0;    // mithril_found when the route was planned
+    ActionType pending = ACT_END;
+
+    // find_path scratch, kept between calls so large maps allocate once. A state's
+    // fields are reset the first time a search touches it, see scratch_touch()
+    Grid<int, N, 4> dist;               // g-values
+    Grid<int, N, 4> toggles;            // ring toggles on the best path, tie-breaker
+    Grid<int, N, 4> prev_state;         // state_id of the predecessor
+    Grid<char, N, 4> action_taken;
+    Grid<bool, N, 4> closed;
+    Grid<int, N, 4> scratch_stamp;      // search that last reset the state
+    int scratch_search = 0;
+    vector<vector<vector<OpenNode>>> open_buckets; // [f][toggles], reused between searches to keep capacity
+    vector<pair<int,int>> open_used;    // buckets pushed to since the last open_clear()
+    int open_f = 0, open_t = 0;         // bucket the next pop starts looking at
+    int open_end = 0;                   // one past the largest f pushed
+    deque<int> frontier_queue;          // frontier_plan's 0-1 BFS over dist/prev_state, state_ids
+    mutable AgentCounters counters;     // per-episode work, see agent.h
+
+    // true-distance heuristic: moves to the target from (x, y, mithril) with the ring
+    // switched for free and unknown cells passable, rebuilt only after update_world()
+    // changed the danger layers or the mithril cells
+    Grid<int, N, 2> true_distance;
+    vector<int> bfs_queue;              // cell * 2 + mithril
+    int true_distance_version = -1;     // world_version the table was built at
+    int true_distance_x = -1, true_distance_y = -1;
+
+    // D* Lite: incremental search backwards from the target over (x,y,ring,mithril).
+    // g/rhs values survive between replans; only states around changed_cells are repaired.
+    // LPA*-style repair needs strictly positive edge costs, so a move costs ds_move and a
+    // ring toggle costs 1: no plan can toggle ds_move times, so this still minimizes moves
+    // first and only breaks ties between equally short plans by their number of toggles
+    ds_cost ds_move;
+    Grid<ds_cost, N, 4> ds_g, ds_rhs;   // indexed by state_id
+    Grid<bool, N, 4> ds_in_open;
+    Grid<pair<ds_cost,ds_cost>, N, 4> ds_open_key; // key a state was last queued with
+    priority_queue<ds_entry, vector<ds_entry>, greater<ds_entry>> ds_open;
+    bool ds_ready = false;
+    int ds_target_x = -1, ds_target_y = -1;
+    int ds_last_x = 0, ds_last_y = 0;   // start position when km was last updated
+    ds_cost ds_km = 0;
+    int ds_start = 0;                   // state the current search is anchored at
+
+    // jump point search: the target and the direction each state was jumped into from
+    // (-1 where all four directions are expanded), reset with the find_path scratch.
+    // jps_stops[mithril] marks the cells jumps stop at
+    int jps_target_x = -1, jps_target_y = -1;
+    Grid<char, N, 4> jps_dir;
+    Bitboard<N> jps_stops[2];
+    int jps_stops_version = -1;
+
+    // HPA*: clusters built on demand, state_id-indexed abstract search reset through
+    // hpa_touched, and the scratch of searches confined to one cluster
+    vector<HpaCluster> hpa_clusters;
+    int hpa_per_row = 0;
+    Grid<int, N> hpa_slot;              // entrance index of a cell in its cluster, -1 elsewhere
+    Grid<int, N, 4> hpa_g, hpa_prev;
+    vector<int> hpa_touched, hpa_chain;
+    vector<pair<int,int>> hpa_start_edges;
+    int hpa_target_cell = -1;           // target hpa_target_cost was computed for
+    vector<int> hpa_target_cost;        // [entrance * 4 + layer] of the target's cluster
+    int local_x0 = 0, local_y0 = 0;     // corner of the cluster the last local search ran in
+    int local_cluster = -1, local_source = -1;
+    vector<int> local_dist, local_prev; // ((x - x0) * HPA_CLUSTER + y - y0) * 4 + layer
+    vector<char> local_action;
+    deque<int> local_queue;
+
+    // HDA*: per-state fields written only by the state's owner thread, reset lazily by stamp
+    Grid<long long, N, 4> hda_g;
+    Grid<int, N, 4> hda_prev, hda_stamp;
+    Grid<char, N, 4> hda_action;
+    int hda_search = 0;
+    vector<unique_ptr<HdaInbox>> hda_inboxes;    // [receiver]
+    unique_ptr<HdaPool> hda_pool;                // kept across replans, rebuilt when the thread count changes
+
+    explicit AstarAgent(int size) : grid_size(size) {
+        dangerous.init(size);
+        seen_cells.init(size);
+        enemies.init(size);
+        mithril_cells.init(size);
+        for (int layer = 0; layer < 4; layer++) danger_layer[layer].init(size);
+        ds_move = 4 * (ds_cost)size * size + 1;
+    }
+
+    // compile-time constant for the fixed-size specializations
+    int size() const { return N > 0 ? N : grid_size; }
+
+    // check coordinates inside grid
+    bool inside(int x, int y) const { return x >= 0 && x < size() && y >= 0 && y < size(); }
+
+    int state_id(int x, int y, int r, int m) const { return ((x * size() + y) * 2 + r) * 2 + m; }
+
+    // stamp the zone of a newly seen enemy into all four danger layers, one row span at a time
+    void add_enemy_zone(int ex, int ey, char enemy) {
+        for (int layer = 0; layer < 4; layer++) {
+            int range = enemy_range(enemy, layer >= 2, (layer & 1) == 1);
+            bool chebyshev = (enemy == NAZGUL || enemy == WATCH); // orcs/uruks use manhattan distance
+            for (int i = max(0, ex - range); i <= min(size() - 1, ex + range); i++) {
+                int half_width = chebyshev ? range : range - abs(i - ex);
+                danger_layer[layer].set_span(i, max(0, ey - half_width), min(size() - 1, ey + half_width), &changed_cells);
+            }
+        }
+    }
+
+    // evaluate if a cell is unsafe given ring/mithril state
+    bool is_dangerous(int x, int y, bool ring, bool mithril) const {
+        counters.is_dangerous_calls++;
+        if (!inside(x, y)) return true;
+        return danger_layer[(ring ? 2 : 0) + (mithril ? 1 : 0)].test(x, y);
+    }
+
+    // mark cells visible from current position
+    void mark_seen() { seen_cells.set_window(current_x, current_y, perception_range); }
+
+    // apply percepts to local world model
+    void update_world(const vector<Percept>& percepts) {
+        size_t changes = changed_cells.size();
+        for (int i = 0; i < percepts.size(); i++) {
+            Percept p = percepts[i];
+            if (!inside(p.x, p.y)) continue;
+            if (p.t == PERCEP) {
+                if (!dangerous.test(p.x, p.y)) changed_cells.push_back(make_pair(p.x, p.y));
+                dangerous.set(p.x, p.y);
+                for (int layer = 0; layer < 4; layer++) danger_layer[layer].set(p.x, p.y);
+            }
+            else if (p.t == MITHRIL) {
+                if (!mithril_cells.test(p.x, p.y)) { changed_cells.push_back(make_pair(p.x, p.y)); mithril_found++; }
+                mithril_cells.set(p.x, p.y);
+            }
+            else if (p.t == MOUNT) { mount_x = p.x; mount_y = p.y; knows_mount = true; }
+            else if (p.t == ORC || p.t == URUK || p.t == NAZGUL || p.t == WATCH) {
+                if (!enemies.test(p.x, p.y)) add_enemy_zone(p.x, p.y, p.t); // enemies never move, stamp once
+                enemies.set(p.x, p.y); dangerous.set(p.x, p.y);
+            }
+        }
+        if (changed_cells.size() != changes) world_version++;
+    }
+
+    // take Mount Doom coordinates revealed by Gollum
+    void learn_mount(const Observation& obs) {
+        if (current_x == goal_x && current_y == goal_y && !knows_mount && obs.has_mount) {
+            mount_x = obs.mount_x; mount_y = obs.mount_y; knows_mount = true;
+        }
+    }
+
+    // Backward BFS from the target over (x, y, mithril). A cell counts as passable
+    // with a mithril state if either ring state makes it safe, so the distances
+    // never exceed a real plan's length and the heuristic stays admissible
+    void build_true_distance(int target_x, int target_y) {
+        if (true_distance_version == world_version && target_x == true_distance_x && target_y == true_distance_y) return;
+        const int INF = 1000000000;
+        true_distance.init(size(), INF);
+        true_distance_version = world_version; true_distance_x = target_x; true_distance_y = target_y;
+        auto passable = [&](int x, int y, int m) { return !danger_layer[m].test(x, y) || !danger_layer[2 + m].test(x, y); };
+
+        bfs_queue.clear();
+        for (int m = 0; m < 2; m++) {
+            true_distance(target_x, target_y, m) = 0;
+            bfs_queue.push_back((target_x * size() + target_y) * 2 + m);
+        }
+        int dx[4] = {-1, 0, 1, 0};
+        int dy[4] = {0, 1, 0, -1};
+        for (size_t head = 0; head < bfs_queue.size(); head++) {
+            int state = bfs_queue[head];
+            int x = (state >> 1) / size(), y = (state >> 1) % size(), m = state & 1;
+            bool mithril_cell = mithril_cells.test(x, y);
+            // moves into (x, y) that end with mithril state m, as (mithril before the move)
+            int from[2], count = 0;
+            if (m == 1 && passable(x, y, 1)) from[count++] = 1;
+            if ((m == 1) == mithril_cell && passable(x, y, 0)) from[count++] = 0; // entering mithril picks it up
+            for (int i = 0; i < count; i++) {
+                for (int dir = 0; dir < 4; dir++) {
+                    int px = x + dx[dir]; int py = y + dy[dir];
+                    if (!inside(px, py) || true_distance(px, py, from[i]) != INF) continue;
+                    true_distance(px, py, from[i]) = true_distance(x, y, m) + 1;
+                    bfs_queue.push_back((px * size() + py) * 2 + from[i]);
+                }
+            }
+        }
+    }
+
+    // start a search over the find_path scratch: only states it touches get reset
+    void scratch_begin() {
+        const int INF = 1000000000;
+        if (scratch_search++ == 0) {
+            dist.init(size(), INF); toggles.init(size(), INF); prev_state.init(size(), -1);
+            action_taken.init(size(), ' '); closed.init(size(), false); jps_dir.init(size(), -1);
+            scratch_stamp.init(size(), 0);
+        }
+    }
+
+    void scratch_touch(int s) {
+        const int INF = 1000000000;
+        if (scratch_stamp[s] == scratch_search) return;
+        scratch_stamp[s] = scratch_search;
+        dist[s] = INF; toggles[s] = INF; prev_state[s] = -1; action_taken[s] = ' '; closed[s] = false; jps_dir[s] = -1;
+    }
+
+    // bucket queue of find_path and jps_plan: [f][toggles], popped by two cursors
+    void open_clear() {
+        for (const pair<int,int>& used : open_used) open_buckets[used.first][used.second].clear();
+        open_used.clear();
+        open_f = 0; open_t = 0; open_end = 0;
+    }
+
+    void open_push(const OpenNode& node, int f, int t) {
+        if (f >= (int)open_buckets.size()) open_buckets.resize(f + 1);
+        if (t >= (int)open_buckets[f].size()) open_buckets[f].resize(t + 1);
+        if (open_buckets[f][t].empty()) open_used.push_back(make_pair(f, t));
+        open_buckets[f][t].push_back(node);
+        open_end = max(open_end, f + 1);
+    }
+
+    // newest entry first: among equal f it has the largest g
+    bool open_pop(OpenNode& node) {
+        while (open_f < open_end) {
+            vector<vector<OpenNode>>& bucket = open_buckets[open_f];
+            while (open_t < (int)bucket.size() && bucket[open_t].empty()) open_t++;
+            if (open_t < (int)bucket.size()) break;
+            open_f++; open_t = 0;
+        }
+        if (open_f == open_end) return false;
+        node = open_buckets[open_f][open_t].back();
+        open_buckets[open_f][open_t].pop_back();
+        return true;
+    }
+
+    // A* search over extended state (x,y,ring,mithril)
+    bool find_path(int start_x, int start_y, int target_x, int target_y,
+                   bool start_ring, bool start_mithril, vector<Step>& path) {
+        const int INF = 1000000000;
+
+        scratch_begin();
+        int start_r = start_ring ? 1 : 0; int start_m = start_mithril ? 1 : 0;
+        scratch_touch(state_id(start_x, start_y, start_r, start_m));
+        dist(start_x, start_y, start_r, start_m) = 0; toggles(start_x, start_y, start_r, start_m) = 0;
+        if (use_true_distance) build_true_distance(target_x, target_y);
+
+        // open list as a bucket queue indexed by f = g + h, each bucket split by toggle
+        // count so equal-length paths avoid needless ring toggles. both heuristics are
+        // consistent (a move costs 1 and lowers h by at most 1, a ring toggle costs 0 and
+        // keeps h), so (f, toggles) never decreases and two cursors over the buckets pop
+        // the minimum in O(1) amortized
+        open_clear();
+        auto push_open = [&](int x, int y, int r, int m) {
+            int h = use_true_distance ? true_distance(x, y, m) : abs(x - target_x) + abs(y - target_y);
+            if (h == INF) return; // the target is out of reach even with free ring toggles
+            open_push({x, y, r, m}, dist(x, y, r, m) + h, toggles(x, y, r, m));
+        };
+        // relax a transition into (x,y,r,m) reaching it with cost g after t toggles
+        auto improves = [&](int x, int y, int r, int m, int g, int t) {
+            scratch_touch(state_id(x, y, r, m));
+            return g < dist(x, y, r, m) || (g == dist(x, y, r, m) && t < toggles(x, y, r, m));
+        };
+        push_open(start_x, start_y, start_r, start_m);
+
+        int dx[4] = {-1, 0, 1, 0};
+        int dy[4] = {0, 1, 0, -1};
+
+        OpenNode node;
+        while (open_pop(node)) {
+            int x = node.x; int y = node.y; int r = node.r; int m = node.m;
+            if (closed(x, y, r, m)) continue; // stale duplicate
+            closed(x, y, r, m) = true;
+            counters.nodes_expanded++;
+
+            // goal reached -> reconstruct path
+            if (x == target_x && y == target_y) {
+                path.clear();
+                int start = state_id(start_x, start_y, start_r, start_m);
+                int cur = state_id(x, y, r, m);
+                while (cur != start) {
+                    char act = action_taken[cur];
+                    if (act == 'M') path.push_back({'M', (cur >> 2) / size(), (cur >> 2) % size()});
+                    else if (act == 'R') path.push_back({'R', -1, -1});
+                    else if (act == 'O') path.push_back({'O', -1, -1});
+                    cur = prev_state[cur];
+                }
+                reverse(path.begin(), path.end());
+                return true;
+            }
+
+            bool ring = (r == 1);
+            bool mithril = (m == 1);
+            int from = state_id(x, y, r, m);
+
+            // zero-cost actions: toggle ring on/off (modeled as same-cost transitions),
+            // only allowed when the current cell stays safe in the new ring state
+            if (!ring && !is_dangerous(x, y, true, mithril)) {
+                int new_r = 1, new_m = m;
+                if (improves(x, y, new_r, new_m, dist(x, y, r, m), toggles(x, y, r, m) + 1)) {
+                    dist(x, y, new_r, new_m) = dist(x, y, r, m); toggles(x, y, new_r, new_m) = toggles(x, y, r, m) + 1;
+                    prev_state(x, y, new_r, new_m) = from;
+                    action_taken(x, y, new_r, new_m) = 'R'; push_open(x, y, new_r, new_m);
+                }
+            }
+            if (ring && !is_dangerous(x, y, false, mithril)) {
+                int new_r = 0, new_m = m;
+                if (improves(x, y, new_r, new_m, dist(x, y, r, m), toggles(x, y, r, m) + 1)) {
+                    dist(x, y, new_r, new_m) = dist(x, y, r, m); toggles(x, y, new_r, new_m) = toggles(x, y, r, m) + 1;
+                    prev_state(x, y, new_r, new_m) = from;
+                    action_taken(x, y, new_r, new_m) = 'O'; push_open(x, y, new_r, new_m);
+                }
+            }
+
+            // explore 4-neighbors (cost +1)
+            for (int dir = 0; dir < 4; dir++) {
+                int nx = x + dx[dir]; int ny = y + dy[dir];
+                if (!inside(nx, ny)) continue;
+                if (is_dangerous(nx, ny, ring, mithril)) continue; // skip unsafe
+
+                int new_m = m; if (mithril_cells.test(nx, ny)) new_m = 1; int new_r = r;
+                if (improves(nx, ny, new_r, new_m, dist(x, y, r, m) + 1, toggles(x, y, r, m))) {
+                    dist(nx, ny, new_r, new_m) = dist(x, y, r, m) + 1; toggles(nx, ny, new_r, new_m) = toggles(x, y, r, m);
+                    prev_state(nx, ny, new_r, new_m) = from;
+                    action_taken(nx, ny, new_r, new_m) = 'M';
+                    push_open(nx, ny, new_r, new_m);
+                }
+            }
+        }
+        return false; // no path found
+    }
+
+    bool is_target_state(int s) const { return (s >> 2) == ds_target_x * size() + ds_target_y; }
+
+    pair<ds_cost,ds_cost> ds_key(int s) const {
+        int x = (s >> 2) / size(), y = (s >> 2) % size();
+        int sx = (ds_start >> 2) / size(), sy = (ds_start >> 2) % size();
+        ds_cost best = min(ds_g[s], ds_rhs[s]);
+        if (best >= DS_INF) return make_pair(DS_INF, DS_INF);
+        return make_pair(best + ds_move * (abs(x - sx) + abs(y - sy)) + ds_km, best);
+    }
+
+    // forward transitions out of s as (cost, next state)
+    int ds_successors(int s, pair<ds_cost,int>* out) const {
+        int x = (s >> 2) / size(), y = (s >> 2) % size(), r = (s >> 1) & 1, m = s & 1;
+        int count = 0;
+        if (!is_dangerous(x, y, r == 0, m == 1)) out[count++] = make_pair((ds_cost)1, state_id(x, y, 1 - r, m));
+        int dx[4] = {-1, 0, 1, 0};
+        int dy[4] = {0, 1, 0, -1};
+        for (int dir = 0; dir < 4; dir++) {
+            int nx = x + dx[dir]; int ny = y + dy[dir];
+            if (!inside(nx, ny) || is_dangerous(nx, ny, r == 1, m == 1)) continue;
+            int new_m = mithril_cells.test(nx, ny) ? 1 : m;
+            out[count++] = make_pair(ds_move, state_id(nx, ny, r, new_m));
+        }
+        return count;
+    }
+
+    // states with a transition into s
+    int ds_predecessors(int s, int* out) const {
+        int x = (s >> 2) / size(), y = (s >> 2) % size(), r = (s >> 1) & 1, m = s & 1;
+        int count = 0;
+        if (!is_dangerous(x, y, r == 1, m == 1)) out[count++] = state_id(x, y, 1 - r, m);
+        bool mithril_cell = mithril_cells.test(x, y);
+        if (mithril_cell && m == 0) return count; // stepping onto mithril always picks it up
+        int dx[4] = {-1, 0, 1, 0};
+        int dy[4] = {0, 1, 0, -1};
+        for (int dir = 0; dir < 4; dir++) {
+            int px = x + dx[dir]; int py = y + dy[dir];
+            if (!inside(px, py)) continue;
+            for (int pm = 0; pm < 2; pm++) {
+                if (pm != m && !mithril_cell) continue;
+                if (!is_dangerous(x, y, r == 1, pm == 1)) out[count++] = state_id(px, py, r, pm);
+            }
+        }
+        return count;
+    }
+
+    void ds_push(int s) {
+        ds_in_open[s] = true; ds_open_key[s] = ds_key(s);
+        ds_open.push(make_pair(ds_open_key[s], s));
+    }
+
+    // drop queue entries that were removed or re-keyed since they were pushed
+    void ds_skip_stale() {
+        while (!ds_open.empty()) {
+            int s = ds_open.top().second;
+            if (ds_in_open[s] && ds_open_key[s] == ds_open.top().first) return;
+            ds_open.pop();
+        }
+    }
+
+    void ds_update_vertex(int s) {
+        if (!is_target_state(s)) {
+            pair<ds_cost,int> succ[5];
+            int count = ds_successors(s, succ);
+            ds_cost best = DS_INF;
+            for (int i = 0; i < count; i++) if (ds_g[succ[i].second] < DS_INF) best = min(best, succ[i].first + ds_g[succ[i].second]);
+            ds_rhs[s] = best;
+        }
+        ds_in_open[s] = false;
+        if (ds_g[s] != ds_rhs[s]) ds_push(s);
+    }
+
+    void ds_initialize(int target_x, int target_y) {
+        ds_g.init(size(), DS_INF); ds_rhs.init(size(), DS_INF);
+        ds_in_open.init(size(), false); ds_open_key.init(size(), make_pair((ds_cost)0, (ds_cost)0));
+        ds_open = decltype(ds_open)();
+        ds_target_x = target_x; ds_target_y = target_y;
+        ds_km = 0; ds_last_x = current_x; ds_last_y = current_y;
+        for (int r = 0; r < 2; r++) for (int m = 0; m < 2; m++) {
+                int s = state_id(target_x, target_y, r, m);
+                ds_rhs[s] = 0; ds_push(s);
+            }
+        ds_ready = true;
+    }
+
+    void ds_compute_shortest_path() {
+        int preds[9];
+        while (true) {
+            ds_skip_stale();
+            if (ds_open.empty()) break;
+            pair<ds_cost,ds_cost> old_key = ds_open.top().first;
+            if (old_key >= ds_key(ds_start) && ds_rhs[ds_start] == ds_g[ds_start]) break;
+            int s = ds_open.top().second;
+            if (old_key < ds_key(s)) { ds_push(s); continue; }
+            ds_open.pop(); ds_in_open[s] = false; counters.nodes_expanded++;
+            if (ds_g[s] > ds_rhs[s]) {
+                ds_g[s] = ds_rhs[s];
+            } else {
+                counters.nodes_reexpanded++; // underconsistent: its old g-value was too low
+                ds_g[s] = DS_INF;
+                ds_update_vertex(s);
+            }
+            int count = ds_predecessors(s, preds);
+            for (int i = 0; i < count; i++) ds_update_vertex(preds[i]);
+        }
+    }
+
+    // incremental replacement for find_path: repairs the previous search instead of starting over
+    bool dstar_plan(int start_x, int start_y, int target_x, int target_y,
+                    bool start_ring, bool start_mithril, vector<Step>& path) {
+        ds_start = state_id(start_x, start_y, start_ring ? 1 : 0, start_mithril ? 1 : 0);
+        if (!ds_ready || target_x != ds_target_x || target_y != ds_target_y) {
+            ds_initialize(target_x, target_y); // new target: previous g/rhs values are meaningless
+            changed_cells.clear();
+        }
+
+        // queued keys must stay lower bounds, so account for every move since the last replan
+        ds_km += ds_move * (abs(start_x - ds_last_x) + abs(start_y - ds_last_y));
+        ds_last_x = start_x; ds_last_y = start_y;
+
+        if (!changed_cells.empty()) {
+            // a changed cell alters toggles made on it and moves made into it
+            int dx[5] = {0, -1, 0, 1, 0};
+            int dy[5] = {0, 0, 1, 0, -1};
+            for (size_t i = 0; i < changed_cells.size(); i++) {
+                for (int dir = 0; dir < 5; dir++) {
+                    int x = changed_cells[i].first + dx[dir]; int y = changed_cells[i].second + dy[dir];
+                    if (!inside(x, y)) continue;
+                    for (int r = 0; r < 2; r++) for (int m = 0; m < 2; m++) ds_update_vertex(state_id(x, y, r, m));
+                }
+            }
+            changed_cells.clear();
+        }
+
+        ds_compute_shortest_path();
+        if (ds_g[ds_start] >= DS_INF) return false;
+
+        // follow the cheapest successors down to the target
+        path.clear();
+        int s = ds_start;
+        pair<ds_cost,int> succ[5];
+        for (int steps = 0; !is_target_state(s) && steps < size() * size() * 4; steps++) {
+            int count = ds_successors(s, succ);
+            int best = -1; ds_cost best_cost = DS_INF;
+            for (int i = 0; i < count; i++) {
+                if (ds_g[succ[i].second] >= DS_INF) continue;
+                ds_cost cost = succ[i].first + ds_g[succ[i].second];
+                if (cost < best_cost) { best_cost = cost; best = succ[i].second; }
+            }
+            if (best == -1) return false;
+            int nx = (best >> 2) / size(), ny = (best >> 2) % size(), nr = (best >> 1) & 1;
+            if ((best >> 2) != (s >> 2)) path.push_back({'M', nx, ny});
+            else path.push_back({nr == 1 ? 'R' : 'O', -1, -1});
+            s = best;
+        }
+        return is_target_state(s);
+    }
+
+    // Jump point search (JPS4) over the states of find_path. Among equally short paths
+    // only canonical ones are followed: x-moves before y-moves, and a y-move turns back
+    // to x only where the cell an earlier x-move would have used is blocked. Jumps stop
+    // where that argument breaks: at the target, at mithril cells and next to any cell
+    // the two ring states disagree on, which are the only places a toggle is worth
+    // making. Every jump is a straight line, so the plan is rebuilt from jump points.
+    void build_jps_stops() {
+        if (jps_stops_version == world_version) return;
+        jps_stops_version = world_version;
+        int words = danger_layer[0].words_per_row();
+        for (int m = 0; m < 2; m++) {
+            jps_stops[m].init(size());
+            auto diff = [&](int x, int w) -> uint64_t {
+                if (x < 0 || x >= size() || w < 0 || w >= words) return 0;
+                return danger_layer[m].row(x)[w] ^ danger_layer[2 + m].row(x)[w];
+            };
+            for (int x = 0; x < size(); x++) {
+                for (int w = 0; w < words; w++) {
+                    uint64_t d = diff(x, w);
+                    jps_stops[m].row(x)[w] = d | (d << 1) | (d >> 1) | (diff(x, w - 1) >> 63) | (diff(x, w + 1) << 63)
+                                           | diff(x - 1, w) | diff(x + 1, w) | mithril_cells.row(x)[w];
+                }
+            }
+        }
+    }
+
+    bool jps_stop(int x, int y, int m) const { return (x == jps_target_x && y == jps_target_y) || jps_stops[m].test(x, y); }
+
+    // y-jump along row x, a word at a time: the first cell that is blocked (no jump point),
+    // a stop cell or a forced turn (free above or below, blocked one step back)
+    int jps_jump_y(int x, int y, int dy, int r, int m) const {
+        const Bitboard<N>& layer = danger_layer[r * 2 + m];
+        int words = layer.words_per_row();
+        const uint64_t* row = layer.row(x);
+        const uint64_t* sides[2] = {x > 0 ? layer.row(x - 1) : nullptr, x + 1 < size() ? layer.row(x + 1) : nullptr};
+        int from = y + dy;
+        if (from < 0 || from >= size()) return 0;
+        for (int w = from >> 6; w >= 0 && w < words; w += dy) {
+            uint64_t valid = dy > 0 ? bit_span(w == (from >> 6) ? (from & 63) : 0, 63) : bit_span(0, w == (from >> 6) ? (from & 63) : 63);
+            uint64_t blocked = row[w];
+            if (w == words - 1 && (size() & 63)) blocked |= ~bit_span(0, (size() - 1) & 63); // past the edge
+            uint64_t stop = jps_stops[m].row(x)[w];
+            if (x == jps_target_x && (jps_target_y >> 6) == w) stop |= (uint64_t)1 << (jps_target_y & 63);
+            for (const uint64_t* side : sides) {
+                if (!side) continue;
+                uint64_t behind = dy > 0 ? (side[w] << 1) | (w > 0 ? side[w - 1] >> 63 : 0)
+                                         : (side[w] >> 1) | (w + 1 < words ? side[w + 1] << 63 : 0);
+                stop |= ~side[w] & behind;
+            }
+            uint64_t events = (blocked | stop) & valid;
+            if (!events) continue;
+            int bit = dy > 0 ? __builtin_ctzll(events) : 63 - __builtin_clzll(events);
+            if ((blocked >> bit) & 1) return 0;
+            return (w * 64 + bit - y) * dy;
+        }
+        return 0;
+    }
+
+    // cells from (x, y) along (dx, dy) to the next jump point, 0 if the line is blocked first
+    int jps_jump(int x, int y, int dx, int dy, int r, int m) const {
+        if (dy != 0) return jps_jump_y(x, y, dy, r, m);
+        const Bitboard<N>& layer = danger_layer[r * 2 + m];
+        for (int steps = 1; ; steps++) {
+            x += dx;
+            if (!inside(x, y) || layer.test(x, y)) return 0;
+            if (jps_stop(x, y, m)) return steps;
+            // x-moves turn to y anywhere, so stop where a y-jump finds something
+            if (jps_jump_y(x, y, -1, r, m) > 0 || jps_jump_y(x, y, 1, r, m) > 0) return steps;
+        }
+    }
+
+    bool jps_plan(int start_x, int start_y, int target_x, int target_y,
+                  bool start_ring, bool start_mithril, vector<Step>& path) {
+        scratch_begin();
+        jps_target_x = target_x; jps_target_y = target_y;
+        build_jps_stops();
+
+        int start_r = start_ring ? 1 : 0; int start_m = start_mithril ? 1 : 0;
+        int start = state_id(start_x, start_y, start_r, start_m);
+        scratch_touch(start);
+        dist[start] = 0; toggles[start] = 0;
+
+        // same open list as find_path; jumps are runs of unit moves, so manhattan stays consistent
+        open_clear();
+        auto reach = [&](int x, int y, int r, int m, int g, int t, int from, char action, int dir) {
+            int s = state_id(x, y, r, m);
+            scratch_touch(s);
+            if (g < dist[s] || (g == dist[s] && t < toggles[s])) {
+                dist[s] = g; toggles[s] = t; prev_state[s] = from; action_taken[s] = action; jps_dir[s] = dir;
+            } else if (g == dist[s] && t == toggles[s] && jps_dir[s] != dir && jps_dir[s] != -1) {
+                jps_dir[s] = -1; // equally good from two directions: expand (again) in all of them
+                closed[s] = false;
+            } else {
+                return;
+            }
+            open_push({x, y, r, m}, g + abs(x - target_x) + abs(y - target_y), t);
+        };
+        open_push({start_x, start_y, start_r, start_m}, abs(start_x - target_x) + abs(start_y - target_y), 0);
+
+        int dx[4] = {-1, 0, 1, 0};
+        int dy[4] = {0, 1, 0, -1};
+
+        OpenNode node;
+        while (open_pop(node)) {
+            int x = node.x; int y = node.y; int r = node.r; int m = node.m;
+            int from = state_id(x, y, r, m);
+            if (closed[from]) continue;
+            closed[from] = true;
+            counters.nodes_expanded++;
+
+            if (x == target_x && y == target_y) {
+                path.clear();
+                for (int cur = from; cur != start; cur = prev_state[cur]) {
+                    if (action_taken[cur] != 'M') { path.push_back({action_taken[cur], -1, -1}); continue; }
+                    int cx = (cur >> 2) / size(), cy = (cur >> 2) % size();
+                    int px = (prev_state[cur] >> 2) / size(), py = (prev_state[cur] >> 2) % size();
+                    int sx = (cx > px) - (cx < px), sy = (cy > py) - (cy < py);
+                    for (; cx != px || cy != py; cx -= sx, cy -= sy) path.push_back({'M', cx, cy});
+                }
+                reverse(path.begin(), path.end());
+                return true;
+            }
+
+            int g = dist[from], t = toggles[from];
+            if (!is_dangerous(x, y, r == 0, m == 1)) reach(x, y, 1 - r, m, g, t + 1, from, r == 0 ? 'R' : 'O', -1);
+
+            int arrived = jps_dir[from];
+            bool all = arrived == -1 || jps_stop(x, y, m);
+            for (int dir = 0; dir < 4; dir++) {
+                if (!all) {
+                    if (dir == (arrived + 2) % 4) continue; // never straight back
+                    if (dy[arrived] != 0 && dir != arrived) {
+                        // after a y-move: straight on, or an x-turn the blocked cell behind forces
+                        if (dy[dir] != 0 || !is_dangerous(x + dx[dir], y - dy[arrived], r == 1, m == 1)) continue;
+                    }
+                }
+                int steps = jps_jump(x, y, dx[dir], dy[dir], r, m);
+                if (steps == 0) continue;
+                int nx = x + dx[dir] * steps; int ny = y + dy[dir] * steps;
+                int new_m = mithril_cells.test(nx, ny) ? 1 : m;
+                reach(nx, ny, r, new_m, g + steps, t, from, 'M', dir);
+            }
+        }
+        return false;
+    }
+
+    int hpa_cluster_of(int x, int y) const { return (x / HPA_CLUSTER) * hpa_per_row + y / HPA_CLUSTER; }
+
+    int local_index(int x, int y, int layer) const { return ((x - local_x0) * HPA_CLUSTER + (y - local_y0)) * 4 + layer; }
+
+    // 0-1 BFS from (x, y, layer) that stays inside one cluster: moves cost 1, toggles 0.
+    // states leave the deque in order of distance, so it may stop at the goal cell, reached
+    // in goal_layer or in any layer when that is -1
+    void hpa_local_search(int cluster, int x, int y, int layer, int goal_x = -1, int goal_y = -1, int goal_layer = -1) {
+        local_x0 = (cluster / hpa_per_row) * HPA_CLUSTER; local_y0 = (cluster % hpa_per_row) * HPA_CLUSTER;
+        int x1 = min(size(), local_x0 + HPA_CLUSTER), y1 = min(size(), local_y0 + HPA_CLUSTER);
+        local_dist.assign(HPA_CLUSTER * HPA_CLUSTER * 4, HPA_INF);
+        local_prev.resize(local_dist.size()); local_action.resize(local_dist.size());
+        int source = local_index(x, y, layer);
+        local_cluster = cluster; local_source = source;
+        local_dist[source] = 0; local_prev[source] = -1;
+        local_queue.clear(); local_queue.push_back(source);
+        int goal = goal_x < 0 ? -1 : local_index(goal_x, goal_y, 0) >> 2;
+
+        int dx[4] = {-1, 0, 1, 0};
+        int dy[4] = {0, 1, 0, -1};
+        while (!local_queue.empty()) {
+            int s = local_queue.front(); local_queue.pop_front();
+            if ((s >> 2) == goal && (goal_layer == -1 || (s & 3) == goal_layer)) return;
+            int cx = local_x0 + (s >> 2) / HPA_CLUSTER, cy = local_y0 + (s >> 2) % HPA_CLUSTER, r = (s >> 1) & 1, m = s & 1;
+            counters.nodes_expanded++;
+            int toggled = s ^ 2;
+            if (!is_dangerous(cx, cy, r == 0, m == 1) && local_dist[s] < local_dist[toggled]) {
+                local_dist[toggled] = local_dist[s]; local_prev[toggled] = s; local_action[toggled] = r == 0 ? 'R' : 'O';
+                local_queue.push_front(toggled);
+            }
+            for (int dir = 0; dir < 4; dir++) {
+                int nx = cx + dx[dir]; int ny = cy + dy[dir];
+                if (nx < local_x0 || nx >= x1 || ny < local_y0 || ny >= y1) continue;
+                if (is_dangerous(nx, ny, r == 1, m == 1)) continue;
+                int next = local_index(nx, ny, r * 2 + (mithril_cells.test(nx, ny) ? 1 : m));
+                if (local_dist[s] + 1 < local_dist[next]) {
+                    local_dist[next] = local_dist[s] + 1; local_prev[next] = s; local_action[next] = 'M';
+                    local_queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    // moves from the last local search's source to (x, y) in its best layer, HPA_INF if out of reach
+    int hpa_local_cost(int x, int y, int* best_layer = nullptr) const {
+        int best = HPA_INF;
+        for (int layer = 0; layer < 4; layer++) {
+            if (local_dist[local_index(x, y, layer)] < best) {
+                best = local_dist[local_index(x, y, layer)];
+                if (best_layer) *best_layer = layer;
+            }
+        }
+        return best;
+    }
+
+    // append the last local search's steps from its source to a local state
+    void hpa_append_local(int goal, vector<Step>& path) {
+        int first = path.size();
+        for (int s = goal; local_prev[s] != -1; s = local_prev[s]) {
+            if (local_action[s] == 'M') path.push_back({'M', local_x0 + (s >> 2) / HPA_CLUSTER, local_y0 + (s >> 2) % HPA_CLUSTER});
+            else path.push_back({local_action[s], -1, -1});
+        }
+        reverse(path.begin() + first, path.end());
+    }
+
+    // local search from an entrance state, for layers in the order 0, 2, 1, 3; false when no
+    // path ever stands there. a free toggle joins the two ring states of a cell, so with the
+    // ring on the search just made with it off is reused
+    bool hpa_search_entrance(int cluster, int x, int y, int layer) {
+        if (is_dangerous(x, y, layer >= 2, layer & 1)) return false;
+        bool joined = layer >= 2 && !is_dangerous(x, y, false, layer & 1);
+        if (!joined || local_cluster != cluster || local_source != local_index(x, y, layer - 2)) hpa_local_search(cluster, x, y, layer);
+        return true;
+    }
+
+    void hpa_add_transition(HpaCluster& cluster, int x, int y, int px, int py) {
+        int slot = hpa_slot(x, y);
+        if (slot < 0) {
+            slot = hpa_slot(x, y) = cluster.entrances.size();
+            cluster.entrances.push_back(x * size() + y);
+            cluster.partners.push_back(vector<int>());
+        }
+        int partner = px * size() + py;
+        if (find(cluster.partners[slot].begin(), cluster.partners[slot].end(), partner) == cluster.partners[slot].end())
+            cluster.partners[slot].push_back(partner);
+    }
+
+    // transitions on one border: cells (x, y) + i * (sx, sy), each paired with the cell (ox, oy)
+    // away in the next cluster. both clusters of a border find the same pairs
+    void hpa_add_border(HpaCluster& cluster, int x, int y, int sx, int sy, int ox, int oy, int length) {
+        if (!inside(x + ox, y + oy)) return;
+        for (int layer = 0; layer < 4; layer++) {
+            int run = 0;
+            for (int i = 0; i <= length; i++) {
+                int cx = x + i * sx, cy = y + i * sy;
+                if (i < length && !is_dangerous(cx, cy, layer >= 2, layer & 1) && !is_dangerous(cx + ox, cy + oy, layer >= 2, layer & 1)) {
+                    run++;
+                    continue;
+                }
+                int first = i - run, last = i - 1;
+                if (run >= HPA_LONG_RUN) {
+                    hpa_add_transition(cluster, x + first * sx, y + first * sy, x + first * sx + ox, y + first * sy + oy);
+                    hpa_add_transition(cluster, x + last * sx, y + last * sy, x + last * sx + ox, y + last * sy + oy);
+                } else if (run > 0) {
+                    int mid = (first + last) / 2;
+                    hpa_add_transition(cluster, x + mid * sx, y + mid * sy, x + mid * sx + ox, y + mid * sy + oy);
+                }
+                run = 0;
+            }
+        }
+    }
+
+    // entrances on the four borders, then the moves between every pair of entrance states
+    void hpa_ensure(int c) {
+        HpaCluster& cluster = hpa_clusters[c];
+        if (cluster.built) return;
+        for (int cell : cluster.entrances) hpa_slot[cell] = -1;
+        cluster.entrances.clear(); cluster.partners.clear();
+        int x0 = (c / hpa_per_row) * HPA_CLUSTER, y0 = (c % hpa_per_row) * HPA_CLUSTER;
+        int x1 = min(size(), x0 + HPA_CLUSTER), y1 = min(size(), y0 + HPA_CLUSTER);
+        hpa_add_border(cluster, x0, y0, 0, 1, -1, 0, y1 - y0);
+        hpa_add_border(cluster, x1 - 1, y0, 0, 1, 1, 0, y1 - y0);
+        hpa_add_border(cluster, x0, y0, 1, 0, 0, -1, x1 - x0);
+        hpa_add_border(cluster, x0, y1 - 1, 1, 0, 0, 1, x1 - x0);
+
+        int count = cluster.entrances.size();
+        cluster.edges.assign(count * 4, vector<pair<int,int>>());
+        for (int e = 0; e < count; e++) {
+            int ex = cluster.entrances[e] / size(), ey = cluster.entrances[e] % size();
+            for (int layer : {0, 2, 1, 3}) { // both ring states of a mithril state in a row
+                if (!hpa_search_entrance(c, ex, ey, layer)) continue;
+                for (int other = 0; other < count; other++) {
+                    int ox = cluster.entrances[other] / size(), oy = cluster.entrances[other] % size();
+                    for (int other_layer = 0; other_layer < 4; other_layer++) {
+                        int cost = local_dist[local_index(ox, oy, other_layer)];
+                        if (cost == HPA_INF || (other == e && other_layer == layer)) continue;
+                        cluster.edges[e * 4 + layer].push_back(make_pair(cost, cluster.entrances[other] * 4 + other_layer));
+                    }
+                }
+            }
+        }
+        cluster.built = true;
+    }
+
+    // HPA*: search the cluster graph from the start to the target, then refine each
+    // edge inside a cluster with a local search. Near-optimal rather than optimal:
+    // paths cross borders only at the transitions
+    bool hpa_plan(int start_x, int start_y, int target_x, int target_y,
+                  bool start_ring, bool start_mithril, vector<Step>& path) {
+        if (hpa_clusters.empty()) {
+            hpa_per_row = (size() + HPA_CLUSTER - 1) / HPA_CLUSTER;
+            hpa_clusters.resize(hpa_per_row * hpa_per_row);
+            hpa_slot.init(size(), -1);
+            hpa_g.init(size(), HPA_INF); hpa_prev.init(size(), -1);
+        }
+
+        // a changed cell invalidates its cluster and, through the transitions, the clusters next to it
+        int cx[5] = {0, -1, 0, 1, 0};
+        int cy[5] = {0, 0, 1, 0, -1};
+        for (size_t i = 0; i < changed_cells.size(); i++) {
+            for (int dir = 0; dir < 5; dir++) {
+                int x = changed_cells[i].first + cx[dir]; int y = changed_cells[i].second + cy[dir];
+                if (inside(x, y)) hpa_clusters[hpa_cluster_of(x, y)].built = false;
+            }
+        }
+        changed_cells.clear();
+
+        // moves from every entrance state of the target's cluster to the target, kept until it changes
+        int target_cluster = hpa_cluster_of(target_x, target_y);
+        if (target_x * size() + target_y != hpa_target_cell || !hpa_clusters[target_cluster].built) {
+            hpa_ensure(target_cluster);
+            const HpaCluster& cluster = hpa_clusters[target_cluster];
+            hpa_target_cost.assign(cluster.entrances.size() * 4, HPA_INF);
+            for (int e = 0; e < (int)cluster.entrances.size(); e++) {
+                for (int layer : {0, 2, 1, 3}) {
+                    if (!hpa_search_entrance(target_cluster, cluster.entrances[e] / size(), cluster.entrances[e] % size(), layer)) continue;
+                    hpa_target_cost[e * 4 + layer] = hpa_local_cost(target_x, target_y);
+                }
+            }
+            hpa_target_cell = target_x * size() + target_y;
+        }
+
+        // the start joins the graph through a local search of its own
+        int start_cluster = hpa_cluster_of(start_x, start_y);
+        int start = state_id(start_x, start_y, start_ring ? 1 : 0, start_mithril ? 1 : 0);
+        hpa_ensure(start_cluster);
+        hpa_local_search(start_cluster, start_x, start_y, start & 3);
+        hpa_start_edges.clear();
+        for (int cell : hpa_clusters[start_cluster].entrances) {
+            for (int layer = 0; layer < 4; layer++) {
+                int cost = local_dist[local_index(cell / size(), cell % size(), layer)];
+                if (cost < HPA_INF) hpa_start_edges.push_back(make_pair(cost, cell * 4 + layer));
+            }
+        }
+        int best = start_cluster == target_cluster ? hpa_local_cost(target_x, target_y) : HPA_INF;
+        int best_from = best < HPA_INF ? start : -1; // last abstract state before the target
+
+        for (int s : hpa_touched) { hpa_g[s] = HPA_INF; hpa_prev[s] = -1; }
+        hpa_touched.clear();
+        priority_queue<pair<int,int>, vector<pair<int,int>>, greater<pair<int,int>>> open;
+        auto heuristic = [&](int s) { return abs((s >> 2) / size() - target_x) + abs((s >> 2) % size() - target_y); };
+        auto relax = [&](int s, int g, int from) {
+            if (g >= hpa_g[s]) return;
+            if (hpa_g[s] == HPA_INF) hpa_touched.push_back(s);
+            hpa_g[s] = g; hpa_prev[s] = from;
+            open.push(make_pair(g + heuristic(s), s));
+        };
+        relax(start, 0, -1);
+
+        while (!open.empty()) {
+            int f = open.top().first, s = open.top().second;
+            open.pop();
+            if (f >= best) break;
+            if (f != hpa_g[s] + heuristic(s)) continue; // stale entry
+            counters.nodes_expanded++;
+
+            int x = (s >> 2) / size(), y = (s >> 2) % size(), r = (s >> 1) & 1, m = s & 1;
+            int c = hpa_cluster_of(x, y);
+            hpa_ensure(c);
+            const HpaCluster& cluster = hpa_clusters[c];
+            int slot = hpa_slot(x, y);
+            int g = hpa_g[s];
+
+            if (s == start) {
+                for (const pair<int,int>& edge : hpa_start_edges) relax(edge.second, g + edge.first, s);
+            } else if (slot >= 0) {
+                for (const pair<int,int>& edge : cluster.edges[slot * 4 + (s & 3)]) relax(edge.second, g + edge.first, s);
+                if (c == target_cluster && g + hpa_target_cost[slot * 4 + (s & 3)] < best) {
+                    best = g + hpa_target_cost[slot * 4 + (s & 3)]; best_from = s;
+                }
+            }
+            if (slot < 0) continue;
+            for (int partner : cluster.partners[slot]) {
+                int px = partner / size(), py = partner % size();
+                if (is_dangerous(px, py, r == 1, m == 1)) continue;
+                relax(state_id(px, py, r, mithril_cells.test(px, py) ? 1 : m), g + 1, s);
+            }
+        }
+        if (best_from == -1) return false;
+
+        // refine: a border crossing is one move, anything inside a cluster a local search
+        hpa_chain.clear();
+        for (int s = best_from; s != -1; s = hpa_prev[s]) hpa_chain.push_back(s);
+        reverse(hpa_chain.begin(), hpa_chain.end());
+        path.clear();
+        for (size_t i = 0; i + 1 < hpa_chain.size(); i++) {
+            int a = hpa_chain[i], b = hpa_chain[i + 1];
+            int bx = (b >> 2) / size(), by = (b >> 2) % size();
+            int c = hpa_cluster_of((a >> 2) / size(), (a >> 2) % size());
+            if (c != hpa_cluster_of(bx, by)) { path.push_back({'M', bx, by}); continue; }
+            hpa_local_search(c, (a >> 2) / size(), (a >> 2) % size(), a & 3, bx, by, b & 3);
+            hpa_append_local(local_index(bx, by, b & 3), path);
+        }
+        int last = hpa_chain.back();
+        int layer = 0;
+        if (local_cluster != target_cluster || local_source != local_index((last >> 2) / size(), (last >> 2) % size(), last & 3))
+            hpa_local_search(target_cluster, (last >> 2) / size(), (last >> 2) % size(), last & 3, target_x, target_y);
+        hpa_local_cost(target_x, target_y, &layer);
+        hpa_append_local(local_index(target_x, target_y, layer), path);
+        return true;
+    }
+
+    // thread owning state s: a hash of its cell's block
+    int hda_owner(int s, int threads) const {
+        unsigned bx = (unsigned)((s >> 2) / size()) >> HDA_BLOCK_SHIFT, by = (unsigned)((s >> 2) % size()) >> HDA_BLOCK_SHIFT;
+        unsigned h = bx * 0x9e3779b1u ^ by * 0x85ebca77u;
+        h ^= h >> 15; h *= 0x2c1b3c6du; h ^= h >> 12;
+        return (int)(h % (unsigned)threads);
+    }
+
+    // Hash-distributed A* over (x,y,ring,mithril) on hda_threads threads. Costs are
+    // scaled like D* Lite's (a move ds_move, a toggle 1), so the plan has as few moves
+    // as find_path's and the fewest toggles among those. A thread expands its own
+    // states and sends the rest to their owners; reaching the target sets a shared
+    // incumbent, and states with f >= incumbent are dropped. The search ends when
+    // `work` (busy threads plus messages not yet taken in) reaches zero: a receiver
+    // marks itself busy before it takes a message off the count, so it never drops
+    // to zero while a message is still on its way. The thread that brings it to zero
+    // wakes the sleeping ones
+    bool hda_plan(int start_x, int start_y, int target_x, int target_y,
+                  bool start_ring, bool start_mithril, vector<Step>& path) {
+        int threads = hda_threads > 0 ? hda_threads : min(HDA_MAX_DEFAULT_THREADS, max(1, (int)thread::hardware_concurrency()));
+        const long long INF = (long long)1 << 60;
+        if (hda_search++ == 0) {
+            hda_g.init(size(), INF); hda_prev.init(size(), -1); hda_stamp.init(size(), 0); hda_action.init(size(), ' ');
+        }
+        if ((int)hda_inboxes.size() != threads) {
+            hda_inboxes.clear();
+            for (int i = 0; i < threads; i++) hda_inboxes.push_back(make_unique<HdaInbox>());
+        }
+        for (int i = 0; i < threads; i++) hda_inboxes[i]->lowest.store(INF);
+        int search = hda_search;
+        int start = state_id(start_x, start_y, start_ring ? 1 : 0, start_mithril ? 1 : 0);
+        long long move_cost = ds_move;
+        atomic<long long> best_cost(INF), work(threads);
+        atomic<bool> done(false);
+        int best_state = -1;
+        mutex best_mutex;
+        vector<long long> expanded(threads, 0);
+
+        auto worker = [&](int me) {
+            // (f, -g, state): among equal f the deepest state first, like find_path's buckets
+            priority_queue<tuple<long long,long long,int>, vector<tuple<long long,long long,int>>, greater<tuple<long long,long long,int>>> open;
+            vector<vector<HdaMessage>> outbox(threads);
+            vector<HdaMessage> inbox;
+            bool busy = true;
+            auto h = [&](int s) { return move_cost * (abs((s >> 2) / size() - target_x) + abs((s >> 2) % size() - target_y)); };
+            auto relax = [&](const HdaMessage& msg) {
+                int s = msg.state;
+                if (hda_stamp[s] != search) { hda_stamp[s] = search; hda_g[s] = INF; }
+                if (msg.g >= hda_g[s]) return;
+                hda_g[s] = msg.g; hda_prev[s] = msg.parent; hda_action[s] = msg.action;
+                if (msg.g + h(s) < best_cost.load(memory_order_relaxed)) open.push(make_tuple(msg.g + h(s), -msg.g, s));
+            };
+            auto send = [&](const HdaMessage& msg) {
+                int to = hda_owner(msg.state, threads);
+                if (to == me) { relax(msg); return; }
+                work.fetch_add(1);
+                outbox[to].push_back(msg);
+                if ((int)outbox[to].size() >= HDA_BATCH) hda_inboxes[to]->post(outbox[to]);
+            };
+            if (hda_owner(start, threads) == me) relax({0, start, -1, ' '});
+
+            int dx[4] = {-1, 0, 1, 0};
+            int dy[4] = {0, 1, 0, -1};
+            while (true) {
+                if (hda_inboxes[me]->take(inbox)) {
+                    if (!busy) { work.fetch_add(1); busy = true; }
+                    for (const HdaMessage& msg : inbox) relax(msg);
+                    work.fetch_sub((long long)inbox.size());
+                    inbox.clear();
+                }
+
+                // a batch of expansions between looks at the inbox, none above the lowest f
+                // any thread holds: expanding ahead of it mostly explores what the
+                // incumbent would prune later
+                hda_inboxes[me]->lowest.store(open.empty() ? INF : get<0>(open.top()), memory_order_relaxed);
+                long long floor = INF;
+                for (int t = 0; t < threads; t++) floor = min(floor, hda_inboxes[t]->lowest.load(memory_order_relaxed));
+                int batch = 0;
+                while (!open.empty() && batch < HDA_BATCH) {
+                    long long f = get<0>(open.top()), g = -get<1>(open.top()); int s = get<2>(open.top());
+                    if (f >= best_cost.load(memory_order_relaxed)) { open = decltype(open)(); break; } // nothing left that could win
+                    if (f > floor) break;
+                    open.pop();
+                    if (hda_g[s] != g) continue; // stale entry
+                    batch++; expanded[me]++;
+                    int x = (s >> 2) / size(), y = (s >> 2) % size(), r = (s >> 1) & 1, m = s & 1;
+                    if (x == target_x && y == target_y) {
+                        lock_guard<mutex> lock(best_mutex);
+                        if (g < best_cost.load()) { best_cost.store(g); best_state = s; }
+                        continue;
+                    }
+                    if (!danger_layer[(1 - r) * 2 + m].test(x, y)) send({g + 1, state_id(x, y, 1 - r, m), s, r == 0 ? 'R' : 'O'});
+                    for (int dir = 0; dir < 4; dir++) {
+                        int nx = x + dx[dir]; int ny = y + dy[dir];
+                        if (!inside(nx, ny) || danger_layer[r * 2 + m].test(nx, ny)) continue;
+                        send({g + move_cost, state_id(nx, ny, r, mithril_cells.test(nx, ny) ? 1 : m), s, 'M'});
+                    }
+                }
+                hda_inboxes[me]->lowest.store(open.empty() ? INF : get<0>(open.top()), memory_order_relaxed);
+                for (int to = 0; to < threads; to++) if (!outbox[to].empty()) hda_inboxes[to]->post(outbox[to]);
+                if (batch > 0) continue;
+                if (!open.empty()) { hda_inboxes[me]->wait(done, true); continue; } // its turn comes when the others' f catch up
+                if (busy) {
+                    busy = false;
+                    if (work.fetch_sub(1) == 1) {
+                        done.store(true);
+                        for (int t = 0; t < threads; t++) if (t != me) hda_inboxes[t]->wake_up();
+                        return;
+                    }
+                }
+                hda_inboxes[me]->wait(done, false);
+                if (done.load()) return;
+            }
+        };
+        if (threads == 1) worker(0);
+        else {
+            if (!hda_pool || hda_pool->size() != threads) {
+                hda_pool.reset();
+                hda_pool = make_unique<HdaPool>(threads);
+            }
+            hda_pool->run(worker);
+        }
+        for (int t = 0; t < threads; t++) counters.nodes_expanded += expanded[t];
+        if (best_state == -1) return false;
+
+        // parents only ever got cheaper after being linked, so the chain is a path of at most the found cost
+        path.clear();
+        for (int cur = best_state; cur != start; cur = hda_prev[cur]) {
+            if (hda_action[cur] == 'M') path.push_back({'M', (cur >> 2) / size(), (cur >> 2) % size()});
+            else path.push_back({hda_action[cur], -1, -1});
+        }
+        reverse(path.begin(), path.end());
+        return true;
+    }
+
+    // Exploration when the target is out of reach: a 0-1 BFS from Frodo's state over
+    // seen cells (toggles free, moves cost 1) scores every reachable cell by the unseen
+    // cells around it over the moves to get there, and plans the whole route to the
+    // best one. New dangers can only cut paths, so the route stays worth walking until
+    // a new mithril cell could open one up. False when nothing unseen is in reach
+    bool frontier_plan(int start_x, int start_y, bool start_ring, bool start_mithril, vector<Step>& path) {
+        scratch_begin();
+        int start = state_id(start_x, start_y, start_ring ? 1 : 0, start_mithril ? 1 : 0);
+        scratch_touch(start);
+        dist[start] = 0;
+        frontier_queue.clear();
+        frontier_queue.push_back(start);
+        int max_gain = (2 * perception_range + 1) * (2 * perception_range + 1) - 1;
+        int best = -1, best_gain = 0, best_moves = 1;
+
+        int dx[4] = {-1, 0, 1, 0};
+        int dy[4] = {0, 1, 0, -1};
+        auto reach = [&](int s, int d, int from, char act) {
+            scratch_touch(s);
+            if (d >= dist[s]) return;
+            dist[s] = d; prev_state[s] = from; action_taken[s] = act;
+            if (act == 'M') frontier_queue.push_back(s); else frontier_queue.push_front(s);
+        };
+        while (!frontier_queue.empty()) {
+            int s = frontier_queue.front(); frontier_queue.pop_front();
+            int x = (s >> 2) / size(), y = (s >> 2) % size(), r = (s >> 1) & 1, m = s & 1;
+            int d = dist[s];
+            // moves only grow from here: no farther cell can beat gain / moves any more
+            if (best != -1 && (long long)max_gain * best_moves <= (long long)best_gain * d) break;
+            counters.nodes_expanded++;
+            if (d > 0) {
+                int gain = seen_cells.count_clear_window(x, y, perception_range);
+                if ((long long)gain * best_moves > (long long)best_gain * d) { best = s; best_gain = gain; best_moves = d; }
+            }
+            if (!is_dangerous(x, y, r == 0, m == 1)) reach(state_id(x, y, 1 - r, m), d, s, r == 0 ? 'R' : 'O');
+            for (int dir = 0; dir < 4; dir++) {
+                int nx = x + dx[dir]; int ny = y + dy[dir];
+                if (!inside(nx, ny) || !seen_cells.test(nx, ny) || is_dangerous(nx, ny, r == 1, m == 1)) continue;
+                reach(state_id(nx, ny, r, mithril_cells.test(nx, ny) ? 1 : m), d + 1, s, 'M');
+            }
+        }
+        if (best == -1) return false;
+
+        path.clear();
+        for (int cur = best; cur != start; cur = prev_state[cur]) {
+            if (action_taken[cur] == 'M') path.push_back({'M', (cur >> 2) / size(), (cur >> 2) % size()});
+            else path.push_back({action_taken[cur], -1, -1});
+        }
+        reverse(path.begin(), path.end());
+        return true;
+    }
+
+    // move command: the position changes right away, the percepts follow in the next step()
+    Action make_move(int new_x, int new_y) {
+        current_x = new_x; current_y = new_y; move_count++;
+        pending = ACT_MOVE;
+        return move_action(new_x, new_y);
+    }
+
+    // ring command, answered by percepts like a move
+    Action toggle_ring(bool turn_on) {
+        ring_active = turn_on;
+        pending = turn_on ? ACT_RING_ON : ACT_RING_OFF;
+        return ring_action(turn_on);
+    }
+
+    // update the world from the percepts after the pending action; false if Frodo died
+    bool observe(const Observation& obs) {
+        update_world(obs.percepts); mark_seen();
+        if (mithril_cells.test(current_x, current_y)) has_mithril = true;
+        learn_mount(obs);
+        if (enemies.test(current_x, current_y)) return false;
+        if (dangerous.test(current_x, current_y)) return false;
+        if (pending != ACT_MOVE && is_dangerous(current_x, current_y, ring_active, has_mithril)) return false;
+        return true;
+    }
+
+    // new game: the header and Gollum line of the protocol
+    void start(int variant, int gollum_x, int gollum_y) {
+        variant_number = variant;
+        perception_range = (variant_number == 1) ? 1 : 2;
+        goal_x = gollum_x; goal_y = gollum_y;
+    }
+
+    // feed the observation after the previous action (the initial percepts on the first call)
+    Action step(const Observation& obs) {
+        if (!started) {
+            started = true;
+            update_world(obs.percepts); mark_seen(); seen_cells.set(0, 0);
+            learn_mount(obs);
+        } else {
+            counters.round_trips++;
+            if (!observe(obs)) return end_action(-1);
+        }
+        return next_action();
+    }
+
+    // leave the current plan
+    void drop_plan() { in_plan = false; step_done = false; }
+
+    // continue planning and executing until the next command for the environment
+    Action next_action() {
+        while (true) {
+            if (in_plan) {
+                if (step_done) {
+                    // plan[plan_pos] is done: stop if the next move became unsafe or Gollum was reached
+                    step_done = false;
+                    if (plan_pos + 1 < (int)plan.size()) {
+                        Step next_step = plan[plan_pos + 1]; if (next_step.action == 'M') if (is_dangerous(next_step.x, next_step.y, ring_active, has_mithril)) { drop_plan(); continue; }
+                    }
+                    if (!knows_mount && current_x == goal_x && current_y == goal_y) { drop_plan(); continue; }
+                    if (exploring && mithril_found != explore_mithril) { drop_plan(); continue; }
+                    plan_pos++;
+                }
+                if (plan_pos >= (int)plan.size()) { drop_plan(); continue; }
+
+                // execute planned steps
+                Step step = plan[plan_pos];
+                if (step.action == 'R' || step.action == 'O') {
+                    bool want_ring = (step.action == 'R');
+                    step_done = true;
+                    if (want_ring == ring_active) continue; // already in that state, nothing to send
+                    return toggle_ring(want_ring);
+                } else if (step.action == 'M') {
+                    if (abs(step.x - current_x) + abs(step.y - current_y) != 1) { drop_plan(); continue; } // invalid plan
+                    if (is_dangerous(step.x, step.y, ring_active, has_mithril)) { drop_plan(); continue; } // safety check
+                    step_done = true;
+                    return make_move(step.x, step.y);
+                }
+                step_done = true;
+                continue;
+            }
+
+            int target_x, target_y;
+            if (!knows_mount) { target_x = goal_x; target_y = goal_y; }
+            else { target_x = mount_x; target_y = mount_y; }
+
+            if (knows_mount && current_x == mount_x && current_y == mount_y) return end_action(move_count);
+
+            counters.replans++;
+            bool found_path;
+            if (planner == PLAN_DSTAR) found_path = dstar_plan(current_x, current_y, target_x, target_y, ring_active, has_mithril, plan);
+            else if (planner == PLAN_JPS) found_path = jps_plan(current_x, current_y, target_x, target_y, ring_active, has_mithril, plan);
+            else if (planner == PLAN_HPA) found_path = hpa_plan(current_x, current_y, target_x, target_y, ring_active, has_mithril, plan);
+            else if (planner == PLAN_HDA) found_path = hda_plan(current_x, current_y, target_x, target_y, ring_active, has_mithril, plan);
+            else found_path = find_path(current_x, current_y, target_x, target_y, ring_active, has_mithril, plan);
+            // D* Lite and HPA* repair from the list and clear it themselves; the others have no use for it
+            if (planner != PLAN_DSTAR && planner != PLAN_HPA) changed_cells.clear();
+
+            exploring = false;
+            if (!found_path && use_frontier) {
+                // known dangers stay, so only a new mithril cell can open a path: give up
+                // when Frodo has it already or even a mithril holder could not get through
+                const int INF = 1000000000;
+                build_true_distance(target_x, target_y);
+                if (has_mithril || true_distance(current_x, current_y, 1) == INF) return end_action(-1);
+                counters.exploration_fallbacks++;
+                if (!frontier_plan(current_x, current_y, ring_active, has_mithril, plan)) return end_action(-1);
+                exploring = true; explore_mithril = mithril_found;
+            } else if (!found_path) {
+                // greedy exploration: pick neighbor that reveals most unseen cells
+                counters.exploration_fallbacks++;
+                vector<pair<int,int>> possible_moves;
+                int dx[4] = {-1,0,1,0}; int dy[4] = {0,1,0,-1};
+                for (int i = 0; i < 4; i++) {
+                    int nx = current_x + dx[i]; int ny = current_y + dy[i];
+                    if (!inside(nx, ny)) continue;
+                    if (enemies.test(nx, ny)) continue;
+                    if (dangerous.test(nx, ny)) continue;
+                    if (is_dangerous(nx, ny, ring_active, has_mithril)) continue;
+                    possible_moves.push_back(make_pair(nx, ny));
+                }
+                if (possible_moves.empty()) return end_action(-1);
+
+                int best_score = -1; pair<int,int> best_move;
+                for (int i = 0; i < possible_moves.size(); i++) {
+                    int nx = possible_moves[i].first; int ny = possible_moves[i].second;
+                    int new_info = seen_cells.count_clear_window(nx, ny, perception_range); // unseen cells in the window
+                    if (new_info > best_score) { best_score = new_info; best_move = possible_moves[i]; }
+                }
+                if (best_score == 0) return end_action(-1);
+                return make_move(best_move.first, best_move.second);
+            }
+
+            in_plan = true; plan_pos = 0; step_done = false;
+        }
+    }
+};
+
+#endif
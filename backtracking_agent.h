@@ -0,0 +1,420 @@
+#ifndef BACKTRACKING_AGENT_H
+#define BACKTRACKING_AGENT_H
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include "agent.h"
+#include "grid.h"
+
+using namespace std;
+
+const int BIG_NUMBER = 1000000000; // large constant for initialization
+
+// what the agent knows about a cell, one byte per cell; values are the protocol letters
+enum CellType : char {
+    CELL_UNKNOWN = '.',
+    CELL_MITHRIL = 'C',
+    CELL_GOLLUM = 'G',
+    CELL_MOUNT = 'M',
+    CELL_ORC = 'O',
+    CELL_URUK = 'U',
+    CELL_NAZGUL = 'N',
+    CELL_WATCH = 'W'
+};
+
+inline bool is_enemy(CellType cell) {
+    return cell == CELL_ORC || cell == CELL_URUK || cell == CELL_NAZGUL || cell == CELL_WATCH;
+}
+
+// one call of the depth-first search, kept on an explicit stack so deep searches
+// on large maps cannot overflow the call stack
+struct SearchFrame {
+    int x, y;
+    bool ring, mithril;
+    int path_length;
+    int toggles;                // ring toggles on the way, tie-breaker between equal lengths
+    int stage;                  // where to continue, see BacktrackingAgent::search()
+    int cells[4][2];            // neighbours to try, closest to the target first
+    int cell_count, next_cell;
+};
+
+struct PlanStep { char action; int x; int y; }; // 'M' move to (x,y), 'R' ring on, 'O' ring off
+
+// whole agent for an N x N map; N == 0 means the size is only known at runtime
+template <int N>
+struct BacktrackingAgent {
+    int grid_size;
+
+    // world representation and agent state
+    Grid<CellType, N> map;
+    Grid<bool, N> danger;
+    vector<pair<int, int>> enemies;    // positions of the enemies seen so far
+    int gollum_x, gollum_y;            // Gollum position
+    int mount_doom_x = -1, mount_doom_y = -1; // Mount Doom position (if found)
+    bool found_mount_doom = false;
+    int current_x = 0, current_y = 0;  // agent current position
+    bool ring_active = false;          // ring state
+    bool has_mithril = false;          // collected mithril
+    int total_moves = 0;
+
+    // memoization for best known distances: [x][y][ring][mithril]
+    Grid<int, N, 4> best_distance;
+    Grid<int, N, 4> best_toggles;      // ring toggles on the path that set best_distance
+    int shortest_path = BIG_NUMBER;    // best path length found so far
+    int shortest_toggles = BIG_NUMBER;
+    AgentCounters counters;            // per-episode work, see agent.h
+    bool use_ida = false;              // iterative deepening instead of one branch-and-bound pass
+    int next_bound = BIG_NUMBER;       // smallest estimate cut by the last pass
+
+    // search() works on the model only; the best path found is then walked for real
+    vector<SearchFrame> stack;
+    vector<PlanStep> best_plan;
+    vector<PlanStep> plan;             // path being walked
+    int plan_pos = 0;
+    int plan_target_x = -1, plan_target_y = -1;
+
+    // step() state
+    bool started = false;
+    ActionType pending = ACT_END;      // command whose percepts have not arrived yet
+
+    explicit BacktrackingAgent(int size) : grid_size(size) {
+        // initialize map and best distances
+        map.init(size, CELL_UNKNOWN);
+        danger.init(size, false);
+        best_distance.init(size, BIG_NUMBER);
+    }
+
+    // compile-time constant for the fixed-size specializations
+    int size() const { return N > 0 ? N : grid_size; }
+
+    // check coordinates are inside the map
+    bool is_inside(int x, int y) {
+        return x >= 0 && x < size() && y >= 0 && y < size();
+    }
+
+    // take Mount Doom coordinates revealed by Gollum
+    void check_for_mount_doom(const Observation& obs) {
+        if (current_x == gollum_x && current_y == gollum_y && !found_mount_doom && obs.has_mount) {
+            mount_doom_x = obs.mount_x;
+            mount_doom_y = obs.mount_y;
+            found_mount_doom = true;
+            if (is_inside(mount_doom_x, mount_doom_y)) {
+                map(mount_doom_x, mount_doom_y) = CELL_MOUNT;
+            }
+        }
+    }
+
+    // update internal map and danger flags from perceptions
+    void update_knowledge(const vector<Percept>& perceptions) {
+        for (const Percept& item : perceptions) {
+            int x = item.x;
+            int y = item.y;
+            if (!is_inside(x, y)) continue;
+            CellType t = (CellType)item.t;
+            if (item.t == 'P') {
+                danger(x, y) = true;            // percept: nearby danger
+            } else if (t == CELL_MITHRIL || t == CELL_GOLLUM) {
+                map(x, y) = t;               // mithril, Gollum
+            } else if (t == CELL_MOUNT) {
+                map(x, y) = CELL_MOUNT;      // Mount Doom
+                mount_doom_x = x;
+                mount_doom_y = y;
+                found_mount_doom = true;
+            } else if (is_enemy(t)) {
+                if (!is_enemy(map(x, y))) enemies.push_back({x, y});
+                map(x, y) = t;                // enemy type
+                danger(x, y) = true;
+            }
+        }
+    }
+
+    // check if cell (x,y) is dangerous given ring/mithril state
+    bool is_dangerous(int x, int y, bool ring, bool mithril) {
+        counters.is_dangerous_calls++;
+        if (!is_inside(x, y)) return true;
+        if (is_enemy(map(x, y))) {
+            return true; // occupied by enemy
+        }
+        if (danger(x, y)) {
+            return true; // marked dangerous by percept
+        }
+        // evaluate the ranges of the known enemies
+        for (const pair<int, int>& e : enemies) {
+            int ex = e.first, ey = e.second;
+            CellType enemy_type = map(ex, ey);
+            if (enemy_type == CELL_ORC) {
+                int range = (ring || mithril) ? 0 : 1;
+                if (abs(ex - x) + abs(ey - y) <= range) return true;
+            } else if (enemy_type == CELL_URUK) {
+                int range = (ring || mithril) ? 1 : 2;
+                if (abs(ex - x) + abs(ey - y) <= range) return true;
+            } else if (enemy_type == CELL_NAZGUL) {
+                int range = ring ? 2 : 1;
+                if (max(abs(ex - x), abs(ey - y)) <= range) return true;
+            } else if (enemy_type == CELL_WATCH) {
+                int range = ring ? 3 : 2;
+                if (max(abs(ex - x), abs(ey - y)) <= range) return true;
+            }
+        }
+        return false;
+    }
+
+    // send move command; the perceptions arrive with the next step()
+    Action move_to(int new_x, int new_y) {
+        current_x = new_x;
+        current_y = new_y;
+        total_moves++;
+        pending = ACT_MOVE;
+        return move_action(new_x, new_y);
+    }
+
+    // update state from the perceptions after a move; false if the move was fatal
+    bool finish_move(const Observation& obs) {
+        update_knowledge(obs.percepts);
+        if (map(current_x, current_y) == CELL_MITHRIL) {
+            has_mithril = true; // collect mithril
+        }
+        check_for_mount_doom(obs); // attempt to read Mount Doom coords
+        // fail if stepped into known enemy or dangerous cell
+        if (is_enemy(map(current_x, current_y)) || danger(current_x, current_y)) {
+            return false;
+        }
+        return true;
+    }
+
+    // toggle ring on/off; returns false when no command is needed
+    bool toggle_ring(bool turn_on) {
+        if (turn_on == ring_active) return false;
+        ring_active = turn_on;
+        pending = turn_on ? ACT_RING_ON : ACT_RING_OFF;
+        return true;
+    }
+
+    // update state from the perceptions after a toggle; false if the new ring state is fatal
+    bool finish_toggle(const Observation& obs) {
+        update_knowledge(obs.percepts);
+        check_for_mount_doom(obs);
+        // check safety after toggling
+        if (is_enemy(map(current_x, current_y)) || danger(current_x, current_y)) {
+            return false;
+        }
+        if (is_dangerous(current_x, current_y, ring_active, has_mithril)) {
+            return false;
+        }
+        return true;
+    }
+
+    // enter search(x, y, ring, mithril, path_length)
+    void push_frame(int x, int y, bool ring, bool mithril, int path_length, int toggles) {
+        SearchFrame frame;
+        frame.x = x; frame.y = y;
+        frame.ring = ring; frame.mithril = mithril;
+        frame.path_length = path_length;
+        frame.toggles = toggles;
+        frame.stage = 0;
+        frame.cell_count = frame.next_cell = 0;
+        stack.push_back(frame);
+        counters.nodes_expanded++;
+    }
+
+    // the moves and toggles leading from the bottom of the stack to the top
+    void record_plan() {
+        best_plan.clear();
+        for (size_t i = 1; i < stack.size(); i++) {
+            const SearchFrame& f = stack[i];
+            if (f.x != stack[i - 1].x || f.y != stack[i - 1].y) best_plan.push_back({'M', f.x, f.y});
+            else best_plan.push_back({f.ring ? 'R' : 'O', -1, -1});
+        }
+    }
+
+    // One depth-first backtracking pass over (x,y,ring,mithril) on the agent's own
+    // map: nothing is sent to the environment. Cells not known to be dangerous
+    // count as passable, so paths may lead through unexplored territory and get
+    // checked against new percepts while they are walked. Paths compare by length,
+    // then by ring toggles, so a plan never toggles without need. Paths that cannot
+    // beat shortest_path/shortest_toggles are cut; the smallest cut estimate is
+    // kept in next_bound. Frame stages:
+    //   0 bound checks, collect neighbours to try
+    //   1 search the next neighbour
+    //   2 try the other ring state at this cell
+    //   3 done
+    void depth_first(int start_x, int start_y, bool start_ring, bool start_mithril, int target_x, int target_y) {
+        best_distance.init(size(), BIG_NUMBER);
+        best_toggles.init(size(), BIG_NUMBER);
+        next_bound = BIG_NUMBER;
+        stack.clear();
+        push_frame(start_x, start_y, start_ring, start_mithril, 0, 0);
+
+        while (!stack.empty()) {
+            SearchFrame& f = stack.back();
+            if (f.stage == 0) {
+                // branch-and-bound: manhattan distance is a lower bound on the remaining moves
+                int bound = f.path_length + abs(f.x - target_x) + abs(f.y - target_y);
+                if (bound > shortest_path || (bound == shortest_path && f.toggles >= shortest_toggles)) {
+                    counters.bound_prunes++;
+                    if (bound > shortest_path) next_bound = min(next_bound, bound);
+                    stack.pop_back();
+                    continue;
+                }
+                int ring_index = f.ring ? 1 : 0;
+                int mithril_index = f.mithril ? 1 : 0;
+                int& best = best_distance(f.x, f.y, ring_index, mithril_index);
+                int& best_t = best_toggles(f.x, f.y, ring_index, mithril_index);
+                if (f.path_length > best || (f.path_length == best && f.toggles >= best_t)) { // prune
+                    counters.memo_prunes++;
+                    stack.pop_back();
+                    continue;
+                }
+                if (best < BIG_NUMBER) counters.nodes_reexpanded++; // reached again on a better path
+                best = f.path_length;
+                best_t = f.toggles;
+
+                // goal test: reached the target
+                if (f.x == target_x && f.y == target_y) {
+                    shortest_path = f.path_length;
+                    shortest_toggles = f.toggles;
+                    record_plan();
+                    stack.pop_back();
+                    continue;
+                }
+
+                // try moving to neighbors
+                int moves[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+                int order[4];
+                for (int i = 0; i < 4; i++) {
+                    int nx = f.x + moves[i][0];
+                    int ny = f.y + moves[i][1];
+                    if (!is_inside(nx, ny)) continue;
+                    CellType cell_type = map(nx, ny);
+                    if (is_enemy(cell_type) || danger(nx, ny)) {
+                        continue; // skip known enemies/danger
+                    }
+                    if (is_dangerous(nx, ny, f.ring, f.mithril)) {
+                        continue; // skip cells that are dangerous under current state
+                    }
+                    // closest to the target first, explored cells before unknown ones on ties
+                    int key = 2 * (abs(nx - target_x) + abs(ny - target_y)) + (cell_type == CELL_UNKNOWN ? 1 : 0);
+                    int j = f.cell_count++;
+                    while (j > 0 && order[j - 1] > key) {
+                        order[j] = order[j - 1];
+                        f.cells[j][0] = f.cells[j - 1][0]; f.cells[j][1] = f.cells[j - 1][1];
+                        j--;
+                    }
+                    order[j] = key;
+                    f.cells[j][0] = nx; f.cells[j][1] = ny;
+                }
+                f.stage = 1;
+            } else if (f.stage == 1) {
+                if (f.next_cell == f.cell_count) { f.stage = 2; continue; }
+                int nx = f.cells[f.next_cell][0];
+                int ny = f.cells[f.next_cell][1];
+                f.next_cell++;
+                bool new_mithril = f.mithril || (map(nx, ny) == CELL_MITHRIL);
+                int new_ring_index = f.ring ? 1 : 0;
+                int new_mithril_index = new_mithril ? 1 : 0;
+                if (f.path_length + 1 > best_distance(nx, ny, new_ring_index, new_mithril_index)) { counters.memo_prunes++; continue; }
+                push_frame(nx, ny, f.ring, new_mithril, f.path_length + 1, f.toggles);
+            } else if (f.stage == 2) {
+                // toggling is free but only allowed where the new ring state is safe
+                f.stage = 3;
+                if (!is_dangerous(f.x, f.y, !f.ring, f.mithril)) push_frame(f.x, f.y, !f.ring, f.mithril, f.path_length, f.toggles + 1);
+            } else {
+                stack.pop_back();
+            }
+        }
+    }
+
+    // Shortest path from start to target on the model. The default engine runs
+    // one branch-and-bound pass; the IDA* engine starts with the manhattan
+    // distance as the length limit and raises it to the smallest cut estimate
+    // until a pass reaches the target, so it never explores paths longer than
+    // the answer. Both return the length (BIG_NUMBER if none) and leave the path
+    // in best_plan.
+    int search(int start_x, int start_y, bool start_ring, bool start_mithril, int target_x, int target_y) {
+        counters.search_calls++;
+        best_plan.clear();
+        shortest_toggles = BIG_NUMBER;
+        if (!use_ida) {
+            shortest_path = BIG_NUMBER;
+            depth_first(start_x, start_y, start_ring, start_mithril, target_x, target_y);
+            return shortest_path;
+        }
+        int limit = abs(start_x - target_x) + abs(start_y - target_y);
+        while (true) {
+            shortest_path = limit; // paths up to the limit count, any number of toggles
+            depth_first(start_x, start_y, start_ring, start_mithril, target_x, target_y);
+            if (shortest_toggles < BIG_NUMBER) return shortest_path;
+            if (next_bound == BIG_NUMBER) return BIG_NUMBER; // nothing was cut: target unreachable
+            limit = next_bound;
+        }
+    }
+
+    // new game: the header and Gollum line of the protocol; the search is the same in
+    // both variants, so the variant number is not needed
+    void start(int /*variant*/, int gx, int gy) {
+        gollum_x = gx; // Gollum position
+        gollum_y = gy;
+        if (is_inside(gollum_x, gollum_y)) map(gollum_x, gollum_y) = CELL_GOLLUM;
+    }
+
+    // feed the perceptions after the previous command (the initial ones on the first call)
+    Action step(const Observation& obs) {
+        if (!started) {
+            started = true;
+            update_knowledge(obs.percepts);
+            check_for_mount_doom(obs);
+            if (danger(0, 0)) { // start is unsafe
+                return end_action(-1);
+            }
+        } else {
+            counters.round_trips++;
+            bool result = (pending == ACT_MOVE) ? finish_move(obs) : finish_toggle(obs);
+            if (!result) return end_action(-1);
+        }
+        return next_action();
+    }
+
+    // Walk the planned path, searching again whenever the next step turned out to
+    // be dangerous or the target changed. Real commands are only sent for the
+    // path being walked.
+    Action next_action() {
+        while (true) {
+            int target_x = found_mount_doom ? mount_doom_x : gollum_x;
+            int target_y = found_mount_doom ? mount_doom_y : gollum_y;
+
+            if (found_mount_doom && current_x == mount_doom_x && current_y == mount_doom_y) {
+                // report the shortest path from the start over everything learned on the way
+                int length = search(0, 0, false, false, mount_doom_x, mount_doom_y);
+                return end_action(length < BIG_NUMBER ? length : total_moves);
+            }
+
+            if (plan_pos < (int)plan.size() && target_x == plan_target_x && target_y == plan_target_y) {
+                PlanStep next = plan[plan_pos];
+                if (next.action == 'M') {
+                    if (!is_dangerous(next.x, next.y, ring_active, has_mithril)) {
+                        plan_pos++;
+                        return move_to(next.x, next.y);
+                    }
+                } else {
+                    bool turn_on = (next.action == 'R');
+                    if (!is_dangerous(current_x, current_y, turn_on, has_mithril)) {
+                        plan_pos++;
+                        if (toggle_ring(turn_on)) return ring_action(turn_on);
+                        continue; // ring already in that state
+                    }
+                }
+            }
+
+            // no usable plan: search the model again from here
+            if (current_x == target_x && current_y == target_y) return end_action(-1); // at Gollum but no Mount Doom
+            counters.replans++;
+            if (search(current_x, current_y, ring_active, has_mithril, target_x, target_y) == BIG_NUMBER) return end_action(-1);
+            plan = best_plan;
+            plan_pos = 0;
+            plan_target_x = target_x; plan_target_y = target_y;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,394 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "astar_agent.h"
+#include "backtracking_agent.h"
+#include "environment.h"
+#include "maps.h"
+#include "protocol.h"
+using namespace std;
+
+// Microbenchmarks for the planner hot paths on fixed map fixtures:
+//   bench [--filter=TEXT] [--min-time=SECONDS]
+// Each line reports time per call, expanded search nodes per second (planners
+// only, from the agents' counters) and heap allocations per call.
+
+// every heap allocation in the process goes through here: plain, array, nothrow
+// and over-aligned forms all count, and each delete frees the way its new allocated
+static long long allocation_count = 0;
+
+static void* counted_alloc(size_t size) {
+    allocation_count++;
+    return malloc(size ? size : 1);
+}
+
+static void* counted_alloc_aligned(size_t size, align_val_t align) {
+    allocation_count++;
+    size_t a = (size_t)align;
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, a);
+#else
+    return aligned_alloc(a, (size + a - 1) / a * a + (size ? 0 : a)); // a multiple of the alignment
+#endif
+}
+
+// out of line: GCC would otherwise see free() inlined into code whose pointer came from
+// operator new, and warn about a mismatch that these replacements do not have
+[[gnu::noinline]] static void free_counted(void* p) { free(p); }
+
+[[gnu::noinline]] static void free_aligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void* operator new(size_t size) {
+    if (void* p = counted_alloc(size)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* p = counted_alloc(size)) return p;
+    throw bad_alloc();
+}
+void* operator new(size_t size, const nothrow_t&) noexcept { return counted_alloc(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return counted_alloc(size); }
+void operator delete(void* p) noexcept { free_counted(p); }
+void operator delete[](void* p) noexcept { free_counted(p); }
+void operator delete(void* p, size_t) noexcept { free_counted(p); }
+void operator delete[](void* p, size_t) noexcept { free_counted(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { free_counted(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { free_counted(p); }
+
+void* operator new(size_t size, align_val_t align) {
+    if (void* p = counted_alloc_aligned(size, align)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t size, align_val_t align) {
+    if (void* p = counted_alloc_aligned(size, align)) return p;
+    throw bad_alloc();
+}
+void* operator new(size_t size, align_val_t align, const nothrow_t&) noexcept { return counted_alloc_aligned(size, align); }
+void* operator new[](size_t size, align_val_t align, const nothrow_t&) noexcept { return counted_alloc_aligned(size, align); }
+void operator delete(void* p, align_val_t) noexcept { free_aligned(p); }
+void operator delete[](void* p, align_val_t) noexcept { free_aligned(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { free_aligned(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { free_aligned(p); }
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept { free_aligned(p); }
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept { free_aligned(p); }
+
+// fixed seeds, so every build benchmarks the same maps
+struct Fixture {
+    string name;
+    MapConfig config;
+    unsigned seed;
+    MapData map;
+    Observation full_view;              // every cell of the map, as percepts
+    vector<Observation> walk;           // radius-2 percepts along a walk over every cell
+    vector<pair<int, int>> walk_cells;  // positions of the walk
+};
+
+// with_walk == false leaves the walk empty for fixtures only the planners run on
+Fixture make_fixture(const string& name, int size, int watches, int uruks, int nazgul, int orcs, unsigned seed, bool with_walk = true) {
+    Fixture f;
+    f.name = name;
+    f.config.size = size;
+    int counts[4] = {watches, uruks, nazgul, orcs};
+    for (int t = 0; t < 4; t++) f.config.enemy_min[t] = f.config.enemy_max[t] = counts[t];
+    f.seed = seed;
+
+    MapGenerator generator;
+    generator.config = f.config;
+    mt19937 gen(seed);
+    if (!generator.generate(gen, f.map)) {
+        cerr << name << ": fixture does not fit" << endl;
+        exit(1);
+    }
+    f.full_view.percepts = get_percepts(size, 0, 0, size, false, false, f.map, true);
+    for (int x = 0; with_walk && x < size; x++) {
+        for (int i = 0; i < size; i++) {
+            int y = (x % 2 == 0) ? i : size - 1 - i; // row by row, turning at the edges
+            Observation obs;
+            obs.percepts = get_percepts(size, x, y, 2, false, false, f.map, true);
+            f.walk.push_back(obs);
+            f.walk_cells.push_back({x, y});
+        }
+    }
+    return f;
+}
+
+// Timed sections of one benchmark; only time between start() and stop() counts.
+struct Sample {
+    long long ops = 0, nodes = 0, allocations = 0;
+    double seconds = 0;
+    chrono::steady_clock::time_point started;
+    long long allocations_at_start = 0;
+
+    void start() { allocations_at_start = allocation_count; started = chrono::steady_clock::now(); }
+    void stop() {
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        allocations += allocation_count - allocations_at_start;
+    }
+};
+
+string filter;
+double min_time = 0.2;
+
+// repeat body(sample) until min_time of measured time is collected, then print a line
+template <typename Body>
+void measure(const string& function, const Fixture& fixture, Body body) {
+    string name = function + " " + fixture.name;
+    if (!filter.empty() && name.find(filter) == string::npos) return;
+    Sample sample;
+    while (sample.seconds < min_time) body(sample);
+    double ns_per_op = sample.seconds * 1e9 / sample.ops;
+    printf("%-34s %-16s %12.1f ns/op", function.c_str(), fixture.name.c_str(), ns_per_op);
+    if (sample.nodes > 0) printf(" %12.3g nodes/s", sample.nodes / sample.seconds);
+    else printf(" %20s", "");
+    printf(" %10.2f allocs/op\n", (double)sample.allocations / sample.ops);
+}
+
+volatile long long sink; // keeps results of benchmarked calls alive
+
+// plans from the start to Gollum and from Gollum to Mount Doom on the full map, ten
+// replans against each target as in an episode, so per-target caches are built once
+template <int SIZE>
+void bench_planners(const Fixture& f) {
+    int size = f.config.size;
+    struct Variant { const char* name; Planner planner; bool true_distance; int threads; };
+    Variant variants[9] = {
+        {"astar find_path", PLAN_ASTAR, false, 0}, {"astar find_path (bfs h)", PLAN_ASTAR, true, 0},
+        {"astar jps", PLAN_JPS, false, 0}, {"astar hpa", PLAN_HPA, false, 0},
+        {"astar hda (1 thread)", PLAN_HDA, false, 1}, {"astar hda (4 threads)", PLAN_HDA, false, 4},
+        {"astar hda (8 threads)", PLAN_HDA, false, 8}, {"astar hda (16 threads)", PLAN_HDA, false, 16},
+        {"astar hda", PLAN_HDA, false, 0},
+    };
+    for (const Variant& variant : variants) {
+        measure(variant.name, f, [&](Sample& s) {
+            AstarAgent<SIZE> agent(size);
+            agent.use_true_distance = variant.true_distance;
+            agent.hda_threads = variant.threads;
+            agent.update_world(f.full_view.percepts);
+            vector<Step> path;
+            auto plan = [&](int sx, int sy, int tx, int ty) {
+                if (variant.planner == PLAN_JPS) agent.jps_plan(sx, sy, tx, ty, false, false, path);
+                else if (variant.planner == PLAN_HPA) agent.hpa_plan(sx, sy, tx, ty, false, false, path);
+                else if (variant.planner == PLAN_HDA) agent.hda_plan(sx, sy, tx, ty, false, false, path);
+                else agent.find_path(sx, sy, tx, ty, false, false, path);
+            };
+            plan(0, 0, f.map.gollum.first, f.map.gollum.second); // warm the scratch buffers
+            long long nodes = agent.counters.nodes_expanded;
+            s.start();
+            for (int i = 0; i < 10; i++) plan(0, 0, f.map.gollum.first, f.map.gollum.second);
+            for (int i = 0; i < 10; i++) plan(f.map.gollum.first, f.map.gollum.second, f.map.mount.first, f.map.mount.second);
+            s.stop();
+            s.ops += 20;
+            s.nodes += agent.counters.nodes_expanded - nodes;
+        });
+    }
+
+    // the first HPA* plan on a map, building every cluster it touches
+    measure("astar hpa (cold)", f, [&](Sample& s) {
+        AstarAgent<SIZE> agent(size);
+        agent.update_world(f.full_view.percepts);
+        vector<Step> path;
+        s.start();
+        agent.hpa_plan(0, 0, f.map.gollum.first, f.map.gollum.second, false, false, path);
+        s.stop();
+        s.ops += 1;
+        s.nodes += agent.counters.nodes_expanded;
+    });
+}
+
+template <int SIZE>
+void bench_astar(const Fixture& f) {
+    int size = f.config.size;
+
+    measure("astar is_dangerous", f, [&](Sample& s) {
+        AstarAgent<SIZE> agent(size);
+        agent.update_world(f.full_view.percepts);
+        long long count = 0;
+        s.start();
+        for (int x = 0; x < size; x++) for (int y = 0; y < size; y++)
+            for (int r = 0; r < 2; r++) for (int m = 0; m < 2; m++) count += agent.is_dangerous(x, y, r == 1, m == 1);
+        s.stop();
+        sink = count;
+        s.ops += 4LL * size * size;
+    });
+
+    measure("astar update_world", f, [&](Sample& s) {
+        AstarAgent<SIZE> agent(size);
+        s.start();
+        for (const Observation& obs : f.walk) { agent.update_world(obs.percepts); agent.changed_cells.clear(); }
+        s.stop();
+        s.ops += f.walk.size();
+    });
+
+    bench_planners<SIZE>(f);
+}
+
+template <int SIZE>
+void bench_backtracking(const Fixture& f) {
+    int size = f.config.size;
+
+    measure("backtracking is_dangerous", f, [&](Sample& s) {
+        BacktrackingAgent<SIZE> agent(size);
+        agent.update_knowledge(f.full_view.percepts);
+        long long count = 0;
+        s.start();
+        for (int x = 0; x < size; x++) for (int y = 0; y < size; y++)
+            for (int r = 0; r < 2; r++) for (int m = 0; m < 2; m++) count += agent.is_dangerous(x, y, r == 1, m == 1);
+        s.stop();
+        sink = count;
+        s.ops += 4LL * size * size;
+    });
+
+    measure("backtracking update_knowledge", f, [&](Sample& s) {
+        BacktrackingAgent<SIZE> agent(size);
+        s.start();
+        for (const Observation& obs : f.walk) agent.update_knowledge(obs.percepts);
+        s.stop();
+        s.ops += f.walk.size();
+    });
+
+    for (int ida = 0; ida < 2; ida++) {
+        measure(ida ? "backtracking search (ida)" : "backtracking search", f, [&](Sample& s) {
+            BacktrackingAgent<SIZE> agent(size);
+            agent.use_ida = ida == 1;
+            agent.update_knowledge(f.full_view.percepts);
+            agent.search(0, 0, false, false, f.map.gollum.first, f.map.gollum.second); // warm the stack
+            long long nodes = agent.counters.nodes_expanded;
+            s.start();
+            agent.search(0, 0, false, false, f.map.gollum.first, f.map.gollum.second);
+            agent.search(f.map.gollum.first, f.map.gollum.second, false, false, f.map.mount.first, f.map.mount.second);
+            s.stop();
+            s.ops += 2;
+            s.nodes += agent.counters.nodes_expanded - nodes;
+        });
+    }
+}
+
+// percepts for every step of the walk, radius 2, scanning the enemies per cell or
+// reading the environment's tables
+void bench_environment(const Fixture& f) {
+    int size = f.config.size;
+
+    measure("environment get_percepts", f, [&](Sample& s) {
+        long long count = 0;
+        s.start();
+        for (const pair<int, int>& at : f.walk_cells) count += get_percepts(size, at.first, at.second, 2, false, false, f.map, true).size();
+        s.stop();
+        sink = count;
+        s.ops += f.walk.size();
+    });
+
+    measure("environment observe", f, [&](Sample& s) {
+        s.start();
+        Environment env(f.map, size, 2);
+        long long count = 0;
+        for (const pair<int, int>& at : f.walk_cells) {
+            env.curx = at.first; env.cury = at.second;
+            count += env.observe().percepts.size();
+        }
+        s.stop();
+        sink = count;
+        s.ops += f.walk.size();
+    });
+}
+
+// full-knowledge optimum of the whole task, as the tester computes it for every map
+void bench_oracle(const Fixture& f) {
+    measure("oracle solve", f, [&](Sample& s) {
+        Oracle oracle;
+        oracle.solve(f.map, f.config.size); // warm the scratch lists
+        long long total = 0;
+        s.start();
+        for (int i = 0; i < 20; i++) total += oracle.solve(f.map, f.config.size);
+        s.stop();
+        sink = total;
+        s.ops += 20;
+    });
+}
+
+// one percept batch per step of the walk, both encodings
+void bench_protocol(const Fixture& f) {
+    for (int binary = 0; binary < 2; binary++) {
+        string wire = binary ? "binary" : "text";
+        measure("protocol encode " + wire, f, [&](Sample& s) {
+            string out;
+            long long bytes = 0;
+            s.start();
+            for (const Observation& obs : f.walk) {
+                out.clear();
+                if (binary) append_percepts_binary(out, obs);
+                else append_percepts_text(out, obs);
+                bytes += out.size();
+            }
+            s.stop();
+            sink = bytes;
+            s.ops += f.walk.size();
+        });
+
+        string stream;
+        for (const Observation& obs : f.walk) {
+            if (binary) append_percepts_binary(stream, obs);
+            else append_percepts_text(stream, obs);
+        }
+        measure("protocol decode " + wire, f, [&](Sample& s) {
+            WireReader in;
+            in.assign(stream.data(), stream.size());
+            Observation obs;
+            long long count = 0;
+            s.start();
+            for (size_t i = 0; i < f.walk.size(); i++) {
+                if (binary) read_percepts_binary(in, obs);
+                else read_percepts_text(in, obs, false);
+                count += obs.percepts.size();
+            }
+            s.stop();
+            sink = count;
+            s.ops += f.walk.size();
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) filter = arg.substr(9);
+        else if (arg.rfind("--min-time=", 0) == 0) min_time = stod(arg.substr(11));
+    }
+
+    vector<Fixture> fixtures;
+    fixtures.push_back(make_fixture("13x13", 13, 1, 1, 1, 2, 1));
+    fixtures.push_back(make_fixture("13x13-dense", 13, 2, 2, 1, 6, 2));
+    fixtures.push_back(make_fixture("32x32", 32, 2, 2, 2, 6, 3));
+    fixtures.push_back(make_fixture("32x32-dense", 32, 6, 6, 4, 24, 4));
+    fixtures.push_back(make_fixture("64x64-dense", 64, 20, 20, 12, 80, 5));
+
+    for (const Fixture& f : fixtures) {
+        if (f.config.size == 13) bench_astar<13>(f);
+        else bench_astar<0>(f);
+    }
+    for (const Fixture& f : fixtures) {
+        if (f.config.size == 13) bench_backtracking<13>(f);
+        else bench_backtracking<0>(f);
+    }
+    for (const Fixture& f : fixtures) bench_environment(f);
+    for (const Fixture& f : fixtures) bench_protocol(f);
+    for (const Fixture& f : fixtures) bench_oracle(f);
+
+    // large sparse maps for the planners only; a walk over every cell would not fit
+    vector<Fixture> large;
+    large.push_back(make_fixture("256x256-sparse", 256, 8, 8, 8, 24, 6, false));
+    large.push_back(make_fixture("512x512-sparse", 512, 16, 16, 16, 48, 7, false));
+    large.push_back(make_fixture("1024x1024-sparse", 1024, 32, 32, 32, 96, 8, false));
+    for (const Fixture& f : large) bench_planners<0>(f);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Row storage for Bitboard: row x owns words_per_row() consecutive 64-bit words,
+// bit (y & 63) of word (y >> 6) is column y. Same N convention as Grid in grid.h.
+template <int N>
+struct BitboardStorage {
+    static const int WORDS = (N + 63) / 64;
+    std::array<uint64_t, N * WORDS> words;
+
+    void allocate(int) {}
+    int size() const { return N; }
+    int words_per_row() const { return WORDS; }
+    uint64_t* row(int x) { return &words[x * WORDS]; }
+    const uint64_t* row(int x) const { return &words[x * WORDS]; }
+    int word_count() const { return N * WORDS; }
+    uint64_t* data() { return words.data(); }
+};
+
+template <>
+struct BitboardStorage<0> {
+    std::unique_ptr<uint64_t[]> words;
+    int n = 0, wpr = 0;
+
+    void allocate(int size) {
+        if (size == n && words) return;
+        n = size; wpr = (size + 63) / 64;
+        words.reset(new uint64_t[n * wpr]);
+    }
+    int size() const { return n; }
+    int words_per_row() const { return wpr; }
+    uint64_t* row(int x) { return &words[x * wpr]; }
+    const uint64_t* row(int x) const { return &words[x * wpr]; }
+    int word_count() const { return n * wpr; }
+    uint64_t* data() { return words.get(); }
+};
+
+// bits lo..hi (inclusive, 0..63) of a word
+inline uint64_t bit_span(int lo, int hi) {
+    uint64_t upto_hi = (hi == 63) ? ~(uint64_t)0 : (((uint64_t)1 << (hi + 1)) - 1);
+    return upto_hi & (~(uint64_t)0 << lo);
+}
+
+inline int popcount64(uint64_t v) { return __builtin_popcountll(v); }
+
+// One bit per cell of a size x size map. Row spans and square windows are
+// handled a word at a time, so a perception window costs one masked
+// AND/OR/popcount per row instead of a per-cell loop.
+template <int N>
+struct Bitboard : BitboardStorage<N> {
+    void init(int size) {
+        this->allocate(size);
+        uint64_t* w = this->data();
+        for (int i = 0; i < this->word_count(); i++) w[i] = 0;
+    }
+
+    bool test(int x, int y) const { return (this->row(x)[y >> 6] >> (y & 63)) & 1; }
+    void set(int x, int y) { this->row(x)[y >> 6] |= (uint64_t)1 << (y & 63); }
+
+    // set columns y0..y1 of row x; cells that were clear are appended to newly_set
+    void set_span(int x, int y0, int y1, std::vector<std::pair<int,int>>* newly_set) {
+        uint64_t* r = this->row(x);
+        for (int w = y0 >> 6; w <= (y1 >> 6); w++) {
+            int lo = (w == (y0 >> 6)) ? (y0 & 63) : 0;
+            int hi = (w == (y1 >> 6)) ? (y1 & 63) : 63;
+            uint64_t fresh = bit_span(lo, hi) & ~r[w];
+            r[w] |= fresh;
+            while (newly_set && fresh) {
+                newly_set->push_back(std::make_pair(x, w * 64 + __builtin_ctzll(fresh)));
+                fresh &= fresh - 1;
+            }
+        }
+    }
+
+    // number of clear cells in columns y0..y1 of row x
+    int count_clear_span(int x, int y0, int y1) const {
+        const uint64_t* r = this->row(x);
+        int count = 0;
+        for (int w = y0 >> 6; w <= (y1 >> 6); w++) {
+            int lo = (w == (y0 >> 6)) ? (y0 & 63) : 0;
+            int hi = (w == (y1 >> 6)) ? (y1 & 63) : 63;
+            count += popcount64(bit_span(lo, hi) & ~r[w]);
+        }
+        return count;
+    }
+
+    // set every cell within Chebyshev distance `radius` of (cx, cy), clipped to the map
+    void set_window(int cx, int cy, int radius) {
+        int x0 = std::max(0, cx - radius), x1 = std::min(this->size() - 1, cx + radius);
+        int y0 = std::max(0, cy - radius), y1 = std::min(this->size() - 1, cy + radius);
+        if (y0 > y1) return;
+        for (int x = x0; x <= x1; x++) set_span(x, y0, y1, nullptr);
+    }
+
+    // clear cells within Chebyshev distance `radius` of (cx, cy), clipped to the map
+    int count_clear_window(int cx, int cy, int radius) const {
+        int x0 = std::max(0, cx - radius), x1 = std::min(this->size() - 1, cx + radius);
+        int y0 = std::max(0, cy - radius), y1 = std::min(this->size() - 1, cy + radius);
+        if (y0 > y1) return 0;
+        int count = 0;
+        for (int x = x0; x <= x1; x++) count += count_clear_span(x, y0, y1);
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "agent.h"
+#include "maps.h"
+
+// The game itself, as the tester plays it against an agent: percepts for a
+// position and the effect of each command.
+
+// what Frodo sees at (curx, cury) within Chebyshev radius r_percept
+inline std::vector<Percept> get_percepts(int size, int curx, int cury, int r_percept, bool ring, bool mith, const MapData& map, bool have_mount) {
+    std::vector<Percept> percepts;
+    for (int ddx = -r_percept; ddx <= r_percept; ++ddx) {
+        for (int ddy = -r_percept; ddy <= r_percept; ++ddy) {
+            if (std::max(std::abs(ddx), std::abs(ddy)) > r_percept) continue;
+            int px = curx + ddx;
+            int py = cury + ddy;
+            if (px < 0 || px >= size || py < 0 || py >= size) continue;
+            char tok = 0;
+            if (std::make_pair(px, py) == map.gollum) tok = 'G';
+            else if (std::make_pair(px, py) == map.mithril) tok = 'C';
+            else if (have_mount && std::make_pair(px, py) == map.mount) tok = 'M';
+            else {
+                for (auto& e : map.enemies) {
+                    int ex, ey; char et;
+                    std::tie(ex, ey, et) = e;
+                    if (ex == px && ey == py) {
+                        tok = et;
+                        break;
+                    }
+                }
+            }
+            if (tok) {
+                percepts.push_back({px, py, tok});
+            } else if (is_lethal(px, py, ring, mith, map.enemies)) {
+                percepts.push_back({px, py, 'P'});
+            }
+        }
+    }
+    return percepts;
+}
+
+// Per-map lookup tables, built once when an episode starts: the token a cell
+// shows (enemy, Gollum or mithril; Mount Doom is only shown once revealed) and
+// a lethal mask with one bit per (ring, mithril) state. Percepts are then a
+// window read instead of a scan over the enemies for every cell.
+struct PerceptTables {
+    int size = 0;
+    std::vector<char> token;             // 0 for empty cells
+    std::vector<unsigned char> lethal;   // bit ring * 2 + mithril
+
+    void build(const MapData& map, int grid_size) {
+        size = grid_size;
+        token.assign(size * size, 0);
+        lethal.assign(size * size, 0);
+        const int reach = 3; // widest zone: a Watch with the ring on
+        for (auto& e : map.enemies) {
+            int ex, ey; char et;
+            std::tie(ex, ey, et) = e;
+            token[ex * size + ey] = et;
+            for (int x = std::max(0, ex - reach); x <= std::min(size - 1, ex + reach); ++x) {
+                for (int y = std::max(0, ey - reach); y <= std::min(size - 1, ey + reach); ++y) {
+                    for (int state = 0; state < 4; ++state) {
+                        if (in_zone(et, x - ex, y - ey, state >= 2, state % 2 == 1)) lethal[x * size + y] |= 1 << state;
+                    }
+                }
+            }
+        }
+        token[map.mithril.first * size + map.mithril.second] = 'C';
+        token[map.gollum.first * size + map.gollum.second] = 'G';
+    }
+};
+
+// Shortest solution of the whole task with the full map known: from (0, 0) to
+// Gollum, then on to Mount Doom, over (x, y, ring, mithril) states that are not
+// lethal. Moves cost 1, ring toggles are free, and mithril protects from the cell
+// where it is picked up. Breadth-first by cost, one list per distance; the
+// scratch lists are kept between maps.
+struct Oracle {
+    PerceptTables tables;
+    std::vector<int> dist;               // [phase][x][y][ring * 2 + mithril], phase 1 once Gollum was reached
+    std::vector<int> current, next;
+
+    // optimal number of moves, -1 when the task cannot be solved
+    int solve(const MapData& map, int size) {
+        tables.build(map, size);
+        const int INF = 1 << 30;
+        int cells = size * size;
+        dist.assign(2 * cells * 4, INF);
+        current.clear(); next.clear();
+        auto lethal = [&](int cell, int state) { return (tables.lethal[cell] >> state) & 1; };
+        auto reach = [&](std::vector<int>& list, int state_id, int d) {
+            if (d < dist[state_id]) { dist[state_id] = d; list.push_back(state_id); }
+        };
+
+        if (lethal(0, 0)) return -1;
+        reach(current, 0, 0);
+        int gollum = map.gollum.first * size + map.gollum.second;
+        int mount = map.mount.first * size + map.mount.second;
+        int mithril = map.mithril.first * size + map.mithril.second;
+        const int dx[4] = {-1, 1, 0, 0}, dy[4] = {0, 0, -1, 1};
+        for (int d = 0; !current.empty(); ++d) {
+            // current grows while it is scanned: free toggles stay at this distance
+            for (size_t i = 0; i < current.size(); ++i) {
+                int id = current[i];
+                if (dist[id] != d) continue; // reached again more cheaply
+                int state = id % 4, cell = (id / 4) % cells, phase = id / 4 / cells;
+                if (phase == 1 && cell == mount) return d;
+                int toggled = state ^ 2;
+                if (!lethal(cell, toggled)) reach(current, (phase * cells + cell) * 4 + toggled, d);
+                int x = cell / size, y = cell % size;
+                for (int k = 0; k < 4; ++k) {
+                    int nx = x + dx[k], ny = y + dy[k];
+                    if (nx < 0 || nx >= size || ny < 0 || ny >= size) continue;
+                    int ncell = nx * size + ny;
+                    int nstate = (ncell == mithril) ? (state | 1) : state;
+                    if (lethal(ncell, nstate)) continue;
+                    int nphase = (ncell == gollum) ? 1 : phase;
+                    reach(next, (nphase * cells + ncell) * 4 + nstate, d + 1);
+                }
+            }
+            current.swap(next);
+            next.clear();
+        }
+        return -1;
+    }
+};
+
+// the environment's side of one game: applies commands and reports what Frodo sees
+struct Environment {
+    const MapData& map;
+    int size;
+    int r_perc;
+    int curx = 0, cury = 0;
+    bool ring = false, mith = false, have_mount = false, reached_gollum = false;
+    int moves = 0;
+    PerceptTables tables;
+    Observation obs;                     // reused by observe()
+
+    Environment(const MapData& m, int grid_size, int variant) : map(m), size(grid_size), r_perc((variant == 1) ? 1 : 2) {
+        tables.build(map, size);
+    }
+
+    void apply(const Action& action) {
+        if (action.type == ACT_MOVE) {
+            curx = action.x;
+            cury = action.y;
+            moves++;
+            if (std::make_pair(curx, cury) == map.mithril) mith = true;
+            if (std::make_pair(curx, cury) == map.gollum) reached_gollum = true;
+        } else if (action.type == ACT_RING_ON) {
+            ring = true;
+        } else if (action.type == ACT_RING_OFF) {
+            ring = false;
+        }
+    }
+
+    // percepts at the current state, same as get_percepts(); Gollum reveals Mount
+    // Doom on the first visit. The result is overwritten by the next call.
+    const Observation& observe() {
+        obs.percepts.clear();
+        obs.has_mount = false;
+        unsigned char state_bit = 1 << ((ring ? 2 : 0) + (mith ? 1 : 0));
+        for (int px = std::max(0, curx - r_perc); px <= std::min(size - 1, curx + r_perc); ++px) {
+            for (int py = std::max(0, cury - r_perc); py <= std::min(size - 1, cury + r_perc); ++py) {
+                int cell = px * size + py;
+                char tok = tables.token[cell];
+                if (have_mount && tok != 'G' && tok != 'C' && std::make_pair(px, py) == map.mount) tok = 'M';
+                if (tok) obs.percepts.push_back({px, py, tok});
+                else if (tables.lethal[cell] & state_bit) obs.percepts.push_back({px, py, 'P'});
+            }
+        }
+        if (reached_gollum && !have_mount && std::make_pair(curx, cury) == map.gollum) {
+            have_mount = true;
+            obs.has_mount = true;
+            obs.mount_x = map.mount.first;
+            obs.mount_y = map.mount.second;
+        }
+        return obs;
+    }
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <algorithm>
+#include <array>
+#include <memory>
+
+// largest map the agents accept from the protocol header
+const int MAX_GRID_SIZE = 1024;
+// map size used when the header does not carry one (the original assignment)
+const int DEFAULT_GRID_SIZE = 13;
+
+// Cell storage for a size x size map with LAYERS values per cell, indexed
+// (x, y, layer) or (x, y, ring, mithril) when LAYERS == 4. N > 0 fixes the size
+// at compile time and keeps the cells inline, so an agent declared as a local
+// lives entirely on the stack; N == 0 takes the size at runtime and allocates.
+template <typename T, int N, int LAYERS = 1>
+struct Grid {
+    std::array<T, N * N * LAYERS> cells;
+
+    void init(int, T value) { cells.fill(value); }
+    int size() const { return N; }
+    int count() const { return N * N * LAYERS; }
+    T& operator[](int index) { return cells[index]; }
+    const T& operator[](int index) const { return cells[index]; }
+    T& operator()(int x, int y, int layer = 0) { return cells[(x * N + y) * LAYERS + layer]; }
+    const T& operator()(int x, int y, int layer = 0) const { return cells[(x * N + y) * LAYERS + layer]; }
+    T& operator()(int x, int y, int r, int m) { return cells[(x * N + y) * LAYERS + r * 2 + m]; }
+    const T& operator()(int x, int y, int r, int m) const { return cells[(x * N + y) * LAYERS + r * 2 + m]; }
+};
+
+template <typename T, int LAYERS>
+struct Grid<T, 0, LAYERS> {
+    std::unique_ptr<T[]> cells; // plain array rather than vector so bool cells stay addressable
+    int n = 0;
+
+    void init(int size, T value) {
+        if (size != n || !cells) { cells.reset(new T[size * size * LAYERS]); n = size; }
+        std::fill(cells.get(), cells.get() + count(), value);
+    }
+    int size() const { return n; }
+    int count() const { return n * n * LAYERS; }
+    T& operator[](int index) { return cells[index]; }
+    const T& operator[](int index) const { return cells[index]; }
+    T& operator()(int x, int y, int layer = 0) { return cells[(x * n + y) * LAYERS + layer]; }
+    const T& operator()(int x, int y, int layer = 0) const { return cells[(x * n + y) * LAYERS + layer]; }
+    T& operator()(int x, int y, int r, int m) { return cells[(x * n + y) * LAYERS + r * 2 + m]; }
+    const T& operator()(int x, int y, int r, int m) const { return cells[(x * n + y) * LAYERS + r * 2 + m]; }
+};
+
+#endif
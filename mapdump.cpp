@@ -0,0 +1,38 @@
+#include <iostream>
+#include <string>
+#include "maps.h"
+using namespace std;
+
+// Prints a map corpus written by mapgen:
+//   mapdump FILE [FIRST [COUNT]]
+// Without FIRST only the header is shown.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "usage: mapdump FILE [FIRST [COUNT]]" << endl;
+        return 1;
+    }
+    MapCorpus corpus;
+    string error = corpus.open(argv[1]);
+    if (!error.empty()) {
+        cerr << error << endl;
+        return 1;
+    }
+    cout << "maps: " << corpus.count() << endl;
+    cout << "size: " << corpus.grid_size() << endl;
+    cout << "seed: " << corpus.header.seed << endl;
+    cout << "enemy slots: " << corpus.header.enemy_slots << endl;
+    cout << "record bytes: " << corpus.header.record_bytes << endl << endl;
+
+    if (argc < 3) return 0;
+    long long first = stoll(argv[2]);
+    long long count = argc > 3 ? stoll(argv[3]) : 1;
+    if (first < 0 || count < 0) {
+        cerr << "usage: mapdump FILE [FIRST [COUNT]]: FIRST and COUNT must not be negative" << endl;
+        return 1;
+    }
+    for (long long i = first; i - first < count && i < (long long)corpus.count(); ++i) {
+        cout << "#" << i << " ";
+        print_map(corpus.get(i), corpus.grid_size());
+    }
+    return 0;
+}
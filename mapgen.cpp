@@ -0,0 +1,53 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include "maps.h"
+using namespace std;
+
+// Writes a binary map corpus for the tester:
+//   mapgen FILE [--count=K] [--seed=S] [--size=N] [--watch=A-B] [--uruk=A-B] [--nazgul=A-B] [--orc=A-B]
+// The same seed and options always give the same maps, and they are the maps
+// the tester generates itself for that --seed and options.
+int main(int argc, char** argv) {
+    string path;
+    long long count = 1000;
+    unsigned seed = random_device{}();
+    MapGenerator generator;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (parse_map_option(arg, generator.config)) continue;
+        if (arg.rfind("--count=", 0) == 0) count = stoll(arg.substr(8));
+        else if (arg.rfind("--seed=", 0) == 0) seed = (unsigned)stoul(arg.substr(7));
+        else path = arg;
+    }
+    string error = generator.check();
+    if (path.empty() || count < 1 || !error.empty()) {
+        if (!error.empty()) cerr << error << endl;
+        cerr << "usage: mapgen FILE [--count=K] [--seed=S] [--size=N] [--watch=A-B] [--uruk=A-B] [--nazgul=A-B] [--orc=A-B]" << endl;
+        return 1;
+    }
+
+    CorpusWriter writer;
+    if (!writer.open(path, generator.config.size, generator.config.max_enemies(), count, seed)) {
+        cerr << "cannot write " << path << endl;
+        return 1;
+    }
+    mt19937 gen(seed);
+    MapData map;
+    for (long long i = 0; i < count; ++i) {
+        if (!generator.generate(gen, map)) {
+            cerr << "map " << i << ": the enemies leave no room for the key items" << endl;
+            return 1;
+        }
+        if (!writer.add(map)) {
+            cerr << "write failed at map " << i << endl;
+            return 1;
+        }
+    }
+    if (!writer.close()) {
+        cerr << "cannot write " << path << endl;
+        return 1;
+    }
+    cout << path << ": " << count << " maps, size " << generator.config.size << ", seed " << seed << endl;
+    return 0;
+}
@@ -0,0 +1,388 @@
+#ifndef MAPS_H
+#define MAPS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Test maps shared by the tester and the corpus tools: the map model, the
+// seeded generator and the binary corpus format.
+
+struct MapData {
+    std::pair<int, int> gollum;
+    std::pair<int, int> mount;
+    std::pair<int, int> mithril;
+    std::vector<std::tuple<int, int, char>> enemies;
+};
+
+// is a cell at offset (dx, dy) from an enemy inside its zone (the enemy's own cell included)
+inline bool in_zone(char type, int dx, int dy, bool ring, bool mith) {
+    int dist_m = std::abs(dx) + std::abs(dy);
+    int dist_c = std::max(std::abs(dx), std::abs(dy));
+    if (dist_c == 0) return true;
+    if (type == 'O') {
+        int r = (ring || mith) ? 0 : 1;
+        return dist_m <= r;
+    } else if (type == 'U') {
+        int r = (ring || mith) ? 1 : 2;
+        return dist_m <= r;
+    } else if (type == 'N') {
+        int r = ring ? 2 : 1;
+        return dist_c <= r;
+    } else if (type == 'W') {
+        int r = ring ? 3 : 2;
+        return dist_c <= r;
+    }
+    return false;
+}
+
+inline bool is_lethal(int x, int y, bool ring, bool mith, const std::vector<std::tuple<int, int, char>>& enemies) {
+    for (auto& e : enemies) {
+        int ex, ey; char et;
+        std::tie(ex, ey, et) = e;
+        if (in_zone(et, x - ex, y - ey, ring, mith)) return true;
+    }
+    return false;
+}
+
+// Uniform value in [0, n). mt19937's output sequence is fixed by the standard but
+// the std distributions are not, so maps are drawn with this instead to come out
+// identical on every compiler and standard library.
+inline int rand_below(std::mt19937& gen, int n) {
+    return (int)(((uint64_t)(uint32_t)gen() * (uint32_t)n) >> 32);
+}
+
+// enemy types in placement order
+const char ENEMY_TYPES[4] = {'W', 'U', 'N', 'O'};
+
+// What generated maps contain. Each enemy type gets a count drawn uniformly from
+// [enemy_min, enemy_max]; the defaults are the assignment's maps: one Watch, one
+// Uruk, up to one Nazgul and one or two Orcs on 13x13.
+struct MapConfig {
+    int size = 13;
+    int enemy_min[4] = {1, 1, 0, 1};
+    int enemy_max[4] = {1, 1, 1, 2};
+
+    int max_enemies() const { return enemy_max[0] + enemy_max[1] + enemy_max[2] + enemy_max[3]; }
+};
+
+// Parse --size=N, --watch=A-B, --uruk=A-B, --nazgul=A-B or --orc=A-B (a single
+// number means A-B with A == B). Returns false if arg is not one of them.
+inline bool parse_map_option(const std::string& arg, MapConfig& config) {
+    if (arg.rfind("--size=", 0) == 0) { config.size = std::stoi(arg.substr(7)); return true; }
+    const char* names[4] = {"--watch=", "--uruk=", "--nazgul=", "--orc="};
+    for (int t = 0; t < 4; t++) {
+        std::string name = names[t];
+        if (arg.rfind(name, 0) != 0) continue;
+        std::string range = arg.substr(name.size());
+        size_t dash = range.find('-');
+        config.enemy_min[t] = std::stoi(range.substr(0, dash));
+        config.enemy_max[t] = (dash == std::string::npos) ? config.enemy_min[t] : std::stoi(range.substr(dash + 1));
+        return true;
+    }
+    return false;
+}
+
+// Builds maps directly instead of placing everything and retrying: enemies only
+// go on cells whose zone misses the start, their zones are stamped into a lethal
+// mask, and Gollum, Mount Doom and Mithril are drawn from the cells left safe.
+// Buffers are kept between calls, so a batch reuses them.
+struct MapGenerator {
+    MapConfig config;
+    std::vector<char> occupied, lethal; // [x * size + y]
+    std::vector<int> candidates;
+
+    std::string check() const {
+        if (config.size < 2 || config.size > 1024) return "map size must be 2..1024";
+        for (int t = 0; t < 4; t++) {
+            if (config.enemy_min[t] < 0 || config.enemy_min[t] > config.enemy_max[t]) return "bad enemy count range";
+        }
+        return "";
+    }
+
+    void stamp_zone(int ex, int ey, char type) {
+        int n = config.size;
+        for (int x = std::max(0, ex - 2); x <= std::min(n - 1, ex + 2); x++) {
+            for (int y = std::max(0, ey - 2); y <= std::min(n - 1, ey + 2); y++) {
+                if (in_zone(type, x - ex, y - ey, false, false)) lethal[x * n + y] = 1;
+            }
+        }
+    }
+
+    // Uniform random cell accepted by ok(cell). A few random draws almost always
+    // hit one; only crowded maps fall back to listing every acceptable cell.
+    // Returns -1 if there is none.
+    template <typename Accept>
+    int pick_cell(std::mt19937& gen, Accept ok) {
+        int cells = config.size * config.size;
+        for (int attempt = 0; attempt < 32; attempt++) {
+            int c = rand_below(gen, cells);
+            if (ok(c)) return c;
+        }
+        candidates.clear();
+        for (int c = 0; c < cells; c++) {
+            if (ok(c)) candidates.push_back(c);
+        }
+        if (candidates.empty()) return -1;
+        return candidates[rand_below(gen, candidates.size())];
+    }
+
+    // false if the enemies or key items do not fit on the map
+    bool generate(std::mt19937& gen, MapData& map) {
+        int n = config.size;
+        occupied.assign(n * n, 0);
+        lethal.assign(n * n, 0);
+        occupied[0] = 1; // Frodo's start
+        map.enemies.clear();
+
+        for (int t = 0; t < 4; t++) {
+            char type = ENEMY_TYPES[t];
+            int count = config.enemy_min[t] + rand_below(gen, config.enemy_max[t] - config.enemy_min[t] + 1);
+            for (int k = 0; k < count; k++) {
+                // the zone must leave the start safe
+                int c = pick_cell(gen, [&](int cell) { return !occupied[cell] && !in_zone(type, cell / n, cell % n, false, false); });
+                if (c < 0) return false;
+                occupied[c] = 1;
+                stamp_zone(c / n, c % n, type);
+                map.enemies.emplace_back(c / n, c % n, type);
+            }
+        }
+
+        // Gollum, Mount Doom, Mithril: distinct cells outside every zone
+        std::pair<int, int>* keys[3] = {&map.gollum, &map.mount, &map.mithril};
+        for (int k = 0; k < 3; k++) {
+            int c = pick_cell(gen, [&](int cell) { return !occupied[cell] && !lethal[cell]; });
+            if (c < 0) return false;
+            occupied[c] = 1;
+            *keys[k] = {c / n, c % n};
+        }
+        return true;
+    }
+};
+
+inline void print_map(const MapData& map, int size, std::ostream& out = std::cout) {
+    std::vector<std::vector<char>> grid(size, std::vector<char>(size, '.'));
+    grid[0][0] = 'F';
+    grid[map.gollum.first][map.gollum.second] = 'G';
+    grid[map.mount.first][map.mount.second] = 'M';
+    grid[map.mithril.first][map.mithril.second] = 'C';
+    for (auto& e : map.enemies) {
+        int ex, ey; char et;
+        std::tie(ex, ey, et) = e;
+        grid[ex][ey] = et;
+    }
+    out << "Map:" << std::endl;
+    for (auto& row : grid) {
+        for (char c : row) out << c << " ";
+        out << std::endl;
+    }
+    out << std::endl;
+}
+
+// 64-bit mixer (splitmix64's finalizer)
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Zobrist-style content hash of a map: the XOR of one mixed key per piece (what
+// it is and where), so it does not depend on the order enemies are listed in.
+// The same map on a different grid size hashes differently
+inline uint64_t map_hash(const MapData& map, int size) {
+    auto piece = [&](char type, int x, int y) { return mix64(((uint64_t)(unsigned char)type << 40) ^ ((uint64_t)x << 20) ^ (uint64_t)y); };
+    uint64_t h = mix64((uint64_t)size);
+    h ^= piece('G', map.gollum.first, map.gollum.second);
+    h ^= piece('M', map.mount.first, map.mount.second);
+    h ^= piece('C', map.mithril.first, map.mithril.second);
+    for (auto& e : map.enemies) h ^= piece(std::get<2>(e), std::get<0>(e), std::get<1>(e));
+    return h;
+}
+
+// Corpus file: a CorpusHeader followed by `count` records of `record_bytes` each.
+// A record is little-endian uint16 words:
+//   gollum x, y | mount x, y | mithril x, y | enemy count | enemy_slots x (x, y, type)
+// Unused enemy slots are zero. Every record has the same size, so map i sits at a
+// fixed offset and a memory-mapped corpus is read in place without parsing.
+const char CORPUS_MAGIC[8] = {'R', 'I', 'N', 'G', 'M', 'A', 'P', 'S'};
+const uint32_t CORPUS_VERSION = 1;
+
+struct CorpusHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t grid_size;
+    uint32_t enemy_slots;
+    uint32_t record_bytes;
+    uint64_t count;
+    uint64_t seed;         // generator seed, for reference
+};
+static_assert(sizeof(CorpusHeader) == 40, "corpus header layout");
+
+inline uint32_t corpus_record_bytes(int enemy_slots) { return (7 + 3 * enemy_slots) * sizeof(uint16_t); }
+
+// writes records one at a time, so corpora larger than memory can be generated
+struct CorpusWriter {
+    FILE* file = nullptr;
+    CorpusHeader header;
+    std::vector<uint16_t> record;
+
+    bool open(const std::string& path, int grid_size, int enemy_slots, uint64_t count, uint64_t seed) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        std::memcpy(header.magic, CORPUS_MAGIC, sizeof(header.magic));
+        header.version = CORPUS_VERSION;
+        header.grid_size = grid_size;
+        header.enemy_slots = enemy_slots;
+        header.record_bytes = corpus_record_bytes(enemy_slots);
+        header.count = count;
+        header.seed = seed;
+        record.assign(header.record_bytes / sizeof(uint16_t), 0);
+        return std::fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    bool add(const MapData& map) {
+        if (map.enemies.size() > header.enemy_slots) return false;
+        std::fill(record.begin(), record.end(), 0);
+        record[0] = map.gollum.first;  record[1] = map.gollum.second;
+        record[2] = map.mount.first;   record[3] = map.mount.second;
+        record[4] = map.mithril.first; record[5] = map.mithril.second;
+        record[6] = map.enemies.size();
+        for (size_t i = 0; i < map.enemies.size(); i++) {
+            record[7 + 3 * i] = std::get<0>(map.enemies[i]);
+            record[8 + 3 * i] = std::get<1>(map.enemies[i]);
+            record[9 + 3 * i] = (uint8_t)std::get<2>(map.enemies[i]);
+        }
+        return std::fwrite(record.data(), header.record_bytes, 1, file) == 1;
+    }
+
+    bool close() {
+        if (!file) return false;
+        bool ok = std::fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+};
+
+// read-only view of a whole file
+struct MappedFile {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = NULL;
+
+    bool open(const std::string& path) {
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) { close(); return false; }
+        data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) { close(); return false; }
+        size = (size_t)file_size.QuadPart;
+        return true;
+    }
+
+    void close() {
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        data = nullptr; size = 0; mapping = NULL; file = INVALID_HANDLE_VALUE;
+    }
+#else
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (p == MAP_FAILED) return false;
+        data = (const unsigned char*)p;
+        size = st.st_size;
+        return true;
+    }
+
+    void close() {
+        if (data) munmap((void*)data, size);
+        data = nullptr; size = 0;
+    }
+#endif
+
+    ~MappedFile() { close(); }
+};
+
+// memory-mapped corpus; maps are decoded straight from the mapping on access
+struct MapCorpus {
+    MappedFile file;
+    CorpusHeader header;
+
+    // returns an empty string on success, otherwise what is wrong with the file
+    std::string open(const std::string& path) {
+        if (!file.open(path)) return "cannot map " + path;
+        if (file.size < sizeof(CorpusHeader)) return path + ": truncated header";
+        std::memcpy(&header, file.data, sizeof(header));
+        if (std::memcmp(header.magic, CORPUS_MAGIC, sizeof(header.magic)) != 0) return path + ": not a map corpus";
+        if (header.version != CORPUS_VERSION) return path + ": unsupported corpus version " + std::to_string(header.version);
+        // header fields are untrusted: bound them before any arithmetic on them
+        if (header.grid_size < 1 || header.grid_size > 65535) return path + ": bad grid size";
+        if (header.enemy_slots > 0xffff) return path + ": bad enemy slot count"; // the enemy count is one uint16 word
+        if (header.record_bytes != corpus_record_bytes(header.enemy_slots)) return path + ": bad record size";
+        if (header.count > (file.size - sizeof(CorpusHeader)) / header.record_bytes) return path + ": truncated records";
+        for (uint64_t i = 0; i < header.count; i++) {
+            if (!record_in_range(i)) return path + ": map " + std::to_string(i) + " has cells outside the grid";
+        }
+        return "";
+    }
+
+    uint16_t record_word(size_t index, int i) const {
+        uint16_t w;
+        std::memcpy(&w, file.data + sizeof(CorpusHeader) + index * header.record_bytes + 2 * i, sizeof(w));
+        return w;
+    }
+
+    // every coordinate inside the grid and no more enemies than slots
+    bool record_in_range(size_t index) const {
+        int enemy_count = record_word(index, 6);
+        if (enemy_count > (int)header.enemy_slots) return false;
+        for (int i = 0; i < 3 + enemy_count; i++) {
+            int w = i < 3 ? 2 * i : 7 + 3 * (i - 3);
+            if (record_word(index, w) >= header.grid_size || record_word(index, w + 1) >= header.grid_size) return false;
+        }
+        return true;
+    }
+
+    size_t count() const { return header.count; }
+    int grid_size() const { return header.grid_size; }
+
+    // open() checked every record, so the fields are used as they are
+    MapData get(size_t index) const {
+        auto word = [&](int i) { return (int)record_word(index, i); };
+        MapData map;
+        map.gollum = {word(0), word(1)};
+        map.mount = {word(2), word(3)};
+        map.mithril = {word(4), word(5)};
+        int enemy_count = word(6);
+        map.enemies.reserve(enemy_count);
+        for (int i = 0; i < enemy_count; i++) map.enemies.emplace_back(word(7 + 3 * i), word(8 + 3 * i), (char)word(9 + 3 * i));
+        return map;
+    }
+};
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+#include "agent.h"
+#include "grid.h"
+
+// Wire layer of the agent protocol, shared by the agent binaries and the tester.
+//
+// Text messages, one per line:
+//   header    "<variant> [size] [binary]"
+//   Gollum    "gx gy"
+//   percepts  "count", then count "x y T" lines, then "mx my" the first time
+//             Frodo stands on Gollum
+//   commands  "m x y", "r", "rr", "e cost"
+//
+// A header ending in "binary" offers the binary percept encoding. An agent that
+// takes it writes a "binary" line before its first command, and every percept
+// batch after that first command is binary (little-endian):
+//   uint16 count, uint8 flags (1: Mount Doom follows),
+//   count x {uint16 x, uint16 y, char T}, [uint16 mx, uint16 my]
+// Agents that ignore the offer keep the text protocol. Commands are always text.
+//
+// Session mode (agents started with --session): the agent writes a "ready" line
+// once it is up, then plays games until its input closes. The header line of the
+// next game resets it, since every game starts on a fresh agent. Text and
+// binary are settled again for each game.
+
+const uint8_t WIRE_HAS_MOUNT = 1;
+
+// Buffered reader over a file descriptor, with its own number parsing instead
+// of formatted stream input. With fd == -1 it only reads the bytes given to assign().
+struct WireReader {
+    int fd;
+    std::vector<char> buf;
+    size_t pos = 0, end = 0;
+    long long bytes_read = 0;          // everything read from fd so far
+
+    explicit WireReader(int fd = -1) : fd(fd), buf(1 << 16) {
+#ifdef _WIN32
+        if (fd >= 0) _setmode(fd, _O_BINARY); // binary batches may contain \r and ^Z bytes
+#endif
+    }
+
+    void assign(const char* data, size_t size) {
+        if (buf.size() < size) buf.resize(size);
+        memcpy(buf.data(), data, size);
+        pos = 0; end = size;
+    }
+
+    // read whatever is available; false at end of input
+    bool fill() {
+        if (fd < 0) return false;
+        if (pos == end) pos = end = 0;
+        if (end == buf.size()) {
+            memmove(buf.data(), buf.data() + pos, end - pos);
+            end -= pos; pos = 0;
+        }
+        while (true) {
+#ifdef _WIN32
+            int n = _read(fd, buf.data() + end, (unsigned)(buf.size() - end));
+#else
+            ssize_t n = read(fd, buf.data() + end, buf.size() - end);
+            if (n < 0 && errno == EINTR) continue;
+#endif
+            if (n <= 0) return false;
+            end += n;
+            bytes_read += n;
+            return true;
+        }
+    }
+
+    // next byte, or -1 at end of input
+    int peek() { return (pos < end || fill()) ? (unsigned char)buf[pos] : -1; }
+    int get() { return (pos < end || fill()) ? (unsigned char)buf[pos++] : -1; }
+
+    void skip_space() {
+        int c;
+        while ((c = peek()) == ' ' || c == '\n' || c == '\r' || c == '\t') pos++;
+    }
+
+    bool read_int(int& value) {
+        skip_space();
+        bool negative = false;
+        if (peek() == '-') { negative = true; pos++; }
+        int c = peek();
+        if (c < '0' || c > '9') return false;
+        value = 0;
+        while ((c = peek()) >= '0' && c <= '9') { value = value * 10 + (c - '0'); pos++; }
+        if (negative) value = -value;
+        return true;
+    }
+
+    // one non-space character
+    bool read_char(char& value) {
+        skip_space();
+        int c = get();
+        if (c < 0) return false;
+        value = (char)c;
+        return true;
+    }
+
+    // drop the rest of the current line, including the line break
+    void skip_line() {
+        int c;
+        while ((c = get()) >= 0 && c != '\n') {}
+    }
+
+    // rest of the current line, without the line break
+    bool read_line(std::string& line) {
+        line.clear();
+        int c;
+        while ((c = get()) >= 0 && c != '\n') if (c != '\r') line += (char)c;
+        return c >= 0 || !line.empty();
+    }
+
+    bool read_u16(int& value) {
+        int lo = get(), hi = get();
+        if (hi < 0) return false;
+        value = lo | (hi << 8);
+        return true;
+    }
+};
+
+// Output collected in a string and written with one call per flush().
+struct WireWriter {
+    int fd;
+    std::string buf;
+
+    explicit WireWriter(int fd) : fd(fd) {}
+
+    void flush() {
+        size_t done = 0;
+        while (done < buf.size()) {
+#ifdef _WIN32
+            int n = _write(fd, buf.data() + done, (unsigned)(buf.size() - done));
+#else
+            ssize_t n = write(fd, buf.data() + done, buf.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+#endif
+            if (n <= 0) break; // the other side is gone
+            done += n;
+        }
+        buf.clear();
+    }
+};
+
+inline void append_int(std::string& out, long long value) {
+    char digits[20];
+    int n = 0;
+    unsigned long long v = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+    do { digits[n++] = (char)('0' + v % 10); v /= 10; } while (v > 0);
+    if (value < 0) out += '-';
+    while (n > 0) out += digits[--n];
+}
+
+inline void append_u16(std::string& out, int value) {
+    out += (char)(value & 0xff);
+    out += (char)((value >> 8) & 0xff);
+}
+
+// command line of an action: "m x y", "r", "rr" or "e cost"
+inline void append_action(std::string& out, const Action& action) {
+    if (action.type == ACT_MOVE) {
+        out += "m "; append_int(out, action.x); out += ' '; append_int(out, action.y);
+    } else if (action.type == ACT_RING_ON) out += 'r';
+    else if (action.type == ACT_RING_OFF) out += "rr";
+    else { out += "e "; append_int(out, action.cost); }
+    out += '\n';
+}
+
+// Split a command line into words in place: next_word() returns the next run of
+// non-space characters, an empty view at the end of the line.
+inline std::string_view next_word(std::string_view line, size_t& pos) {
+    while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r')) pos++;
+    size_t begin = pos;
+    while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t' && line[pos] != '\r') pos++;
+    return line.substr(begin, pos - begin);
+}
+
+inline bool parse_int(std::string_view word, int& value) {
+    size_t i = (!word.empty() && word[0] == '-') ? 1 : 0;
+    if (i == word.size()) return false;
+    int v = 0;
+    for (; i < word.size(); i++) {
+        if (word[i] < '0' || word[i] > '9') return false;
+        v = v * 10 + (word[i] - '0');
+    }
+    value = word[0] == '-' ? -v : v;
+    return true;
+}
+
+// command line "m x y", "r", "rr" or "e cost" into an action; false for anything else
+inline bool parse_command(std::string_view line, Action& action) {
+    size_t pos = 0;
+    std::string_view cmd = next_word(line, pos);
+    if (cmd == "m") {
+        int x, y;
+        if (!parse_int(next_word(line, pos), x) || !parse_int(next_word(line, pos), y)) return false;
+        action = move_action(x, y);
+    } else if (cmd == "r" || cmd == "rr") {
+        action = ring_action(cmd == "r");
+    } else if (cmd == "e") {
+        int cost;
+        if (!parse_int(next_word(line, pos), cost)) return false;
+        action = end_action(cost);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline void append_percepts_text(std::string& out, const Observation& obs) {
+    append_int(out, (int)obs.percepts.size()); out += '\n';
+    for (const Percept& p : obs.percepts) {
+        append_int(out, p.x); out += ' '; append_int(out, p.y); out += ' '; out += p.t; out += '\n';
+    }
+    if (obs.has_mount) { append_int(out, obs.mount_x); out += ' '; append_int(out, obs.mount_y); out += '\n'; }
+}
+
+inline void append_percepts_binary(std::string& out, const Observation& obs) {
+    append_u16(out, (int)obs.percepts.size());
+    out += (char)(obs.has_mount ? WIRE_HAS_MOUNT : 0);
+    for (const Percept& p : obs.percepts) { append_u16(out, p.x); append_u16(out, p.y); out += p.t; }
+    if (obs.has_mount) { append_u16(out, obs.mount_x); append_u16(out, obs.mount_y); }
+}
+
+// Counters as one JSON object, {"nodes_expanded":12,...}; agents started with
+// --counters write it to stderr as their last output, and the tester reads it back
+inline void append_counters_json(std::string& out, const AgentCounters& counters) {
+    out += '{';
+    for (const CounterField& field : COUNTER_FIELDS) {
+        if (out.back() != '{') out += ',';
+        out += '"'; out += field.name; out += "\":";
+        append_int(out, counters.*field.member);
+    }
+    out += '}';
+}
+
+// fields missing from the record stay as they are
+inline void parse_counters_json(std::string_view json, AgentCounters& counters) {
+    for (const CounterField& field : COUNTER_FIELDS) {
+        std::string key = std::string("\"") + field.name + "\":";
+        size_t at = json.find(key);
+        if (at == std::string_view::npos) continue;
+        long long value = 0;
+        for (size_t i = at + key.size(); i < json.size() && json[i] >= '0' && json[i] <= '9'; i++) value = value * 10 + (json[i] - '0');
+        counters.*field.member = value;
+    }
+}
+
+// the record on stderr at the end of a game, with the bytes the reader received
+// since bytes_before (its count when the game's header was read)
+inline void write_counters(AgentCounters counters, const WireReader& in, long long bytes_before = 0) {
+    counters.bytes_read = in.bytes_read - bytes_before;
+    WireWriter err(2);
+    append_counters_json(err.buf, counters);
+    err.buf += '\n';
+    err.flush();
+}
+
+// text percept batch into the reused percept array; the Mount Doom line is only
+// there when the caller knows Frodo just reached Gollum
+inline bool read_percepts_text(WireReader& in, Observation& obs, bool mount_expected) {
+    obs.percepts.clear();
+    obs.has_mount = false;
+    int count;
+    if (!in.read_int(count)) return false;
+    for (int i = 0; i < count; i++) {
+        Percept p;
+        if (!in.read_int(p.x) || !in.read_int(p.y) || !in.read_char(p.t)) return false;
+        obs.percepts.push_back(p);
+    }
+    if (mount_expected && in.read_int(obs.mount_x) && in.read_int(obs.mount_y)) obs.has_mount = true;
+    in.skip_line(); // a binary batch may follow right after the line break
+    return true;
+}
+
+inline bool read_percepts_binary(WireReader& in, Observation& obs) {
+    obs.percepts.clear();
+    obs.has_mount = false;
+    int count, flags;
+    if (!in.read_u16(count) || (flags = in.get()) < 0) return false;
+    for (int i = 0; i < count; i++) {
+        Percept p;
+        int t;
+        if (!in.read_u16(p.x) || !in.read_u16(p.y) || (t = in.get()) < 0) return false;
+        p.t = (char)t;
+        obs.percepts.push_back(p);
+    }
+    if (flags & WIRE_HAS_MOUNT) {
+        if (!in.read_u16(obs.mount_x) || !in.read_u16(obs.mount_y)) return false;
+        obs.has_mount = true;
+    }
+    return true;
+}
+
+// header line "<variant> [size] [binary]"; the size defaults to the original 13x13 map
+inline bool read_header(WireReader& in, int& variant, int& size, bool& binary) {
+    std::string header;
+    if (!in.read_line(header)) return false;
+    WireReader line;
+    line.assign(header.data(), header.size());
+    variant = 1; size = DEFAULT_GRID_SIZE; binary = false;
+    if (line.read_int(variant)) line.read_int(size);
+    line.skip_space();
+    binary = header.compare(line.pos, std::string::npos, "binary") == 0;
+    return true;
+}
+
+// Play one game once the header line has been read. In the text protocol the
+// Mount Doom line follows the percepts the first time Frodo stands on Gollum,
+// so the position is tracked to know when to read it.
+template <typename Agent>
+int play_protocol(Agent& agent, int variant, bool binary, WireReader& in, WireWriter& out) {
+    int gollum_x, gollum_y;
+    if (!in.read_int(gollum_x) || !in.read_int(gollum_y)) return 0;
+    agent.start(variant, gollum_x, gollum_y);
+
+    Observation obs;
+    int x = 0, y = 0;
+    bool mount_read = false;
+    if (!read_percepts_text(in, obs, false)) return 0;
+    if (binary) out.buf += "binary\n"; // take the offer, goes out with the first command
+    while (true) {
+        Action action = agent.step(obs);
+        append_action(out.buf, action);
+        out.flush();
+        if (action.type == ACT_END) return 0;
+        if (action.type == ACT_MOVE) { x = action.x; y = action.y; }
+
+        bool mount_expected = !mount_read && x == gollum_x && y == gollum_y;
+        if (mount_expected) mount_read = true;
+        if (!(binary ? read_percepts_binary(in, obs) : read_percepts_text(in, obs, mount_expected))) return 0;
+    }
+}
+
+#endif
@@ -1,400 +1,850 @@
 #include <bits/stdc++.h>
-#include <windows.h>
 #include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+#include "agent.h"
+#include "astar_agent.h"
+#include "backtracking_agent.h"
+#include "maps.h"
+#include "environment.h"
+#include "protocol.h"
 using namespace std;
 
-const int N = 13;
+int grid_size = DEFAULT_GRID_SIZE; // from --size or the corpus header
+bool offer_binary = true;          // offer spawned agents the binary percept encoding (--wire=text: never)
+bool collect_counters = false;     // --counters: gather the agents' work counters of every episode
+bool use_sessions = false;         // --session: keep warm agent processes and play many episodes on each
 const int NUM_TESTS = 1000;
 
-struct Percept {
-    int x, y;
-    char t;
-};
-
-struct MapData {
-    pair<int, int> gollum;
-    pair<int, int> mount;
-    pair<int, int> mithril;
-    vector<tuple<int, int, char>> enemies;
-};
+// where the agent binaries are, relative to the current directory
+string agent_binary_path(const string& algo_name) {
+#ifdef _WIN32
+    return algo_name + ".exe";
+#else
+    return "./" + algo_name;
+#endif
+}
 
-bool is_lethal(int x, int y, bool ring, bool mith, const vector<tuple<int, int, char>>& enemies) {
-    for (auto& e : enemies) {
-        int ex, ey; char et;
-        tie(ex, ey, et) = e;
-        if (ex == x && ey == y) return true;
-        int dist_m = abs(ex - x) + abs(ey - y);
-        int dist_c = max(abs(ex - x), abs(ey - y));
-        if (et == 'O') {
-            int r = (ring || mith) ? 0 : 1;
-            if (dist_m <= r) return true;
-        } else if (et == 'U') {
-            int r = (ring || mith) ? 1 : 2;
-            if (dist_m <= r) return true;
-        } else if (et == 'N') {
-            int r = ring ? 2 : 1;
-            if (dist_c <= r) return true;
-        } else if (et == 'W') {
-            int r = ring ? 3 : 2;
-            if (dist_c <= r) return true;
+// one running agent with its stdin/stdout connected to pipes
+struct AgentProcess {
+#ifdef _WIN32
+    HANDLE in_wr = NULL, out_rd = NULL, err_rd = NULL;
+    PROCESS_INFORMATION proc;
+
+    // counters: pass --counters and give the agent's stderr its own pipe;
+    // session: pass --session (protocol.h)
+    bool start(const string& algo_name, bool counters, bool session) {
+        SECURITY_ATTRIBUTES saAttr;
+        saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+        saAttr.bInheritHandle = TRUE;
+        saAttr.lpSecurityDescriptor = NULL;
+
+        HANDLE out_wr = NULL, in_rd = NULL;
+        if (!CreatePipe(&out_rd, &out_wr, &saAttr, 0)) return false;
+        if (!SetHandleInformation(out_rd, HANDLE_FLAG_INHERIT, 0)) return false;
+        if (!CreatePipe(&in_rd, &in_wr, &saAttr, 0)) return false;
+        if (!SetHandleInformation(in_wr, HANDLE_FLAG_INHERIT, 0)) return false;
+        HANDLE err_wr = out_wr;
+        if (counters) {
+            if (!CreatePipe(&err_rd, &err_wr, &saAttr, 0)) return false;
+            if (!SetHandleInformation(err_rd, HANDLE_FLAG_INHERIT, 0)) return false;
         }
+
+        STARTUPINFO siStartInfo;
+        ZeroMemory(&proc, sizeof(PROCESS_INFORMATION));
+        ZeroMemory(&siStartInfo, sizeof(STARTUPINFO));
+        siStartInfo.cb = sizeof(STARTUPINFO);
+        siStartInfo.hStdError = err_wr;
+        siStartInfo.hStdOutput = out_wr;
+        siStartInfo.hStdInput = in_rd;
+        siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+
+        string cmd = agent_binary_path(algo_name);
+        if (counters) cmd += " --counters";
+        if (session) cmd += " --session";
+        bool ok = CreateProcess(NULL, (LPSTR)cmd.c_str(), NULL, NULL, TRUE, 0, NULL, NULL, &siStartInfo, &proc);
+        CloseHandle(out_wr);
+        CloseHandle(in_rd);
+        if (err_wr != out_wr) CloseHandle(err_wr);
+        return ok;
     }
-    return false;
-}
 
-MapData generate_map() {
-    set<pair<int, int>> positions;
-    positions.insert({0, 0});
+    void send(const string& data) {
+        DWORD dwWritten;
+        WriteFile(in_wr, data.c_str(), (DWORD)data.size(), &dwWritten, NULL);
+    }
 
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<int> dist(0, N - 1);
+    // bytes read into buf, 0 once the agent closed its output
+    int receive(char* buf, int cap) {
+        DWORD dwRead;
+        if (!ReadFile(out_rd, buf, cap, &dwRead, NULL)) return 0;
+        return (int)dwRead;
+    }
 
-    auto rand_pos = [&](bool exclude_start = true) -> pair<int, int> {
-        while (true) {
-            int x = dist(gen);
-            int y = dist(gen);
-            if (exclude_start && x == 0 && y == 0) continue;
-            if (positions.find({x, y}) == positions.end()) {
-                positions.insert({x, y});
-                return {x, y};
-            }
-        }
-    };
+    int receive_errors(char* buf, int cap) {
+        DWORD dwRead;
+        if (!err_rd || !ReadFile(err_rd, buf, cap, &dwRead, NULL)) return 0;
+        return (int)dwRead;
+    }
 
-    auto g_pos = rand_pos(true);
-    auto m_pos = rand_pos(true);
-    vector<tuple<int, int, char>> enemies;
+    // everything the agent writes to stderr until it exits
+    string read_errors() {
+        string text;
+        char buf[1024];
+        DWORD dwRead;
+        while (err_rd && ReadFile(err_rd, buf, sizeof(buf), &dwRead, NULL) && dwRead > 0) text.append(buf, dwRead);
+        return text;
+    }
 
-    auto w_pos = rand_pos(false);
-    enemies.emplace_back(w_pos.first, w_pos.second, 'W');
+    void finish() {
+        CloseHandle(in_wr);
+        CloseHandle(out_rd);
+        if (err_rd) CloseHandle(err_rd);
+        CloseHandle(proc.hProcess);
+        CloseHandle(proc.hThread);
+    }
+#else
+    int in_wr = -1, out_rd = -1, err_rd = -1;
+    pid_t pid = -1;
+    static inline mutex spawn_mutex;
+
+    static bool cloexec_pipe(int fds[2]) {
+        if (pipe(fds) != 0) return false;
+        if (fcntl(fds[0], F_SETFD, FD_CLOEXEC) != 0 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) != 0) {
+            close(fds[0]); close(fds[1]);
+            return false;
+        }
+        return true;
+    }
 
-    auto u_pos = rand_pos(false);
-    enemies.emplace_back(u_pos.first, u_pos.second, 'U');
+    // counters: pass --counters and give the agent's stderr its own pipe;
+    // session: pass --session (protocol.h)
+    bool start(const string& algo_name, bool counters, bool session) {
+        // FD_CLOEXEC: agents started concurrently by other workers must not inherit these ends,
+        // or this agent's output would never reach EOF. pipe2() would set it atomically but is
+        // Linux-only, so pipes are made and spawned under one lock instead
+        lock_guard<mutex> lock(spawn_mutex);
+        int in_pipe[2], out_pipe[2], err_pipe[2] = {-1, -1};
+        if (!cloexec_pipe(in_pipe)) return false;
+        if (!cloexec_pipe(out_pipe)) { close(in_pipe[0]); close(in_pipe[1]); return false; }
+        if (counters && !cloexec_pipe(err_pipe)) {
+            close(in_pipe[0]); close(in_pipe[1]); close(out_pipe[0]); close(out_pipe[1]);
+            return false;
+        }
 
-    uniform_real_distribution<double> prob(0.0, 1.0);
-    if (prob(gen) < 0.5) {
-        auto n_pos = rand_pos(false);
-        enemies.emplace_back(n_pos.first, n_pos.second, 'N');
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, in_pipe[0], 0);
+        posix_spawn_file_actions_adddup2(&actions, out_pipe[1], 1);
+        if (counters) posix_spawn_file_actions_adddup2(&actions, err_pipe[1], 2);
+
+        string path = agent_binary_path(algo_name);
+        char counters_flag[] = "--counters", session_flag[] = "--session";
+        char* argv[4] = {(char*)path.c_str(), NULL, NULL, NULL};
+        int argc = 1;
+        if (counters) argv[argc++] = counters_flag;
+        if (session) argv[argc++] = session_flag;
+        int err = posix_spawn(&pid, path.c_str(), &actions, NULL, argv, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(in_pipe[0]);
+        close(out_pipe[1]);
+        if (counters) close(err_pipe[1]);
+        in_wr = in_pipe[1];
+        out_rd = out_pipe[0];
+        err_rd = err_pipe[0];
+        if (err != 0) { finish(); return false; }
+        return true;
     }
 
-    uniform_int_distribution<int> num_o(1, 2);
-    int no = num_o(gen);
-    for (int i = 0; i < no; ++i) {
-        auto o_pos = rand_pos(false);
-        enemies.emplace_back(o_pos.first, o_pos.second, 'O');
+    void send(const string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = write(in_wr, data.c_str() + done, data.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return; // agent exited, the read side sees EOF
+            done += n;
+        }
     }
 
-    auto c_pos = rand_pos(false);
+    int receive(char* buf, int cap) {
+        while (true) {
+            ssize_t n = read(out_rd, buf, cap);
+            if (n < 0 && errno == EINTR) continue;
+            return n < 0 ? 0 : (int)n;
+        }
+    }
 
-    vector<pair<int, int>> key_pos = {{0, 0}, g_pos, m_pos, c_pos};
-    for (auto& kp : key_pos) {
-        if (is_lethal(kp.first, kp.second, false, false, enemies)) {
-            return generate_map();
+    int receive_errors(char* buf, int cap) {
+        while (err_rd >= 0) {
+            ssize_t n = read(err_rd, buf, cap);
+            if (n < 0 && errno == EINTR) continue;
+            return n < 0 ? 0 : (int)n;
         }
+        return 0;
     }
 
-    return {g_pos, m_pos, c_pos, enemies};
-}
+    // everything the agent writes to stderr until it exits
+    string read_errors() {
+        string text;
+        char buf[1024];
+        while (err_rd >= 0) {
+            ssize_t n = read(err_rd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            text.append(buf, n);
+        }
+        return text;
+    }
 
-vector<Percept> get_percepts(int curx, int cury, int r_percept, bool ring, bool mith, const MapData& map, bool have_mount) {
-    vector<Percept> percepts;
-    for (int ddx = -r_percept; ddx <= r_percept; ++ddx) {
-        for (int ddy = -r_percept; ddy <= r_percept; ++ddy) {
-            if (max(abs(ddx), abs(ddy)) > r_percept) continue;
-            int px = curx + ddx;
-            int py = cury + ddy;
-            if (px < 0 || px >= N || py < 0 || py >= N) continue;
-            char tok = 0;
-            if (make_pair(px, py) == map.gollum) tok = 'G';
-            else if (make_pair(px, py) == map.mithril) tok = 'C';
-            else if (have_mount && make_pair(px, py) == map.mount) tok = 'M';
-            else {
-                for (auto& e : map.enemies) {
-                    int ex, ey; char et;
-                    tie(ex, ey, et) = e;
-                    if (ex == px && ey == py) {
-                        tok = et;
-                        break;
-                    }
-                }
+    void finish() {
+        if (in_wr >= 0) close(in_wr);
+        if (out_rd >= 0) close(out_rd);
+        if (err_rd >= 0) close(err_rd);
+        in_wr = out_rd = err_rd = -1;
+        if (pid > 0) { int status; waitpid(pid, &status, 0); }
+        pid = -1;
+    }
+#endif
+};
+
+// Agent output split into lines in place. Chunks are read into a fixed buffer
+// and lines are handed out as views into it; only the unfinished tail of the
+// buffer is ever moved, so a chatty agent costs time linear in its output.
+struct LineBuffer {
+    char data[4096];
+    int start = 0, end = 0;
+
+    // next complete line without the line break, valid until the next call;
+    // false once the agent closed its output (its stderr with errors == true)
+    bool next_line(AgentProcess& agent, string_view& line, bool errors = false) {
+        while (true) {
+            const char* newline = (const char*)memchr(data + start, '\n', end - start);
+            if (newline) {
+                line = string_view(data + start, newline - (data + start));
+                start = (int)(newline - data) + 1;
+                return true;
             }
-            if (tok) {
-                percepts.push_back({px, py, tok});
-            } else if (is_lethal(px, py, ring, mith, map.enemies)) {
-                percepts.push_back({px, py, 'P'});
+            if (start > 0) {
+                memmove(data, data + start, end - start);
+                end -= start;
+                start = 0;
             }
+            if (end == (int)sizeof(data)) end = 0; // no command is this long: drop it
+            int read_count = errors ? agent.receive_errors(data + end, (int)sizeof(data) - end)
+                                    : agent.receive(data + end, (int)sizeof(data) - end);
+            if (read_count <= 0) return false;
+            end += read_count;
         }
     }
-    return percepts;
-}
+};
 
-pair<int, double> run_algo(const string& algo_name, int variant, const MapData& map) {
-    SECURITY_ATTRIBUTES saAttr;
-    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
-    saAttr.bInheritHandle = TRUE;
-    saAttr.lpSecurityDescriptor = NULL;
+// what one agent run on one map produced
+struct EpisodeResult {
+    int cost = -2;                 // reported cost, -1 for a loss, -2 if the agent did not run
+    double time = 0.0;             // seconds
+    int moves = 0;                 // moves Frodo actually made
+    AgentCounters counters;        // filled with --counters
+};
 
-    HANDLE hChildStd_IN_Rd = NULL;
-    HANDLE hChildStd_IN_Wr = NULL;
-    HANDLE hChildStd_OUT_Rd = NULL;
-    HANDLE hChildStd_OUT_Wr = NULL;
+// play one game with a started agent over the wire protocol (protocol.h);
+// result.time runs from the header to the agent's final command
+EpisodeResult play_wire(AgentProcess& agent, LineBuffer& output, int variant, const MapData& map) {
+    EpisodeResult result;
+    auto start_time = chrono::steady_clock::now();
 
-    if (!CreatePipe(&hChildStd_OUT_Rd, &hChildStd_OUT_Wr, &saAttr, 0)) {
-        return {-2, 0.0};
-    }
-    if (!SetHandleInformation(hChildStd_OUT_Rd, HANDLE_FLAG_INHERIT, 0)) {
-        return {-2, 0.0};
-    }
+    // header, Gollum and the first percepts always go out as text
+    string input;
+    append_int(input, variant); input += ' '; append_int(input, grid_size);
+    if (offer_binary) input += " binary";
+    input += '\n';
+    append_int(input, map.gollum.first); input += ' '; append_int(input, map.gollum.second); input += '\n';
+    Environment env(map, grid_size, variant);
+    append_percepts_text(input, env.observe());
+    agent.send(input);
+    bool binary = false; // the agent took the binary offer
+
+    string_view line;
+    int cost = -2;
 
-    if (!CreatePipe(&hChildStd_IN_Rd, &hChildStd_IN_Wr, &saAttr, 0)) {
-        return {-2, 0.0};
-    }
-    if (!SetHandleInformation(hChildStd_IN_Wr, HANDLE_FLAG_INHERIT, 0)) {
-        return {-2, 0.0};
-    }
+    while (output.next_line(agent, line)) {
+        size_t pos = 0;
+        string_view first = next_word(line, pos);
+        if (first.empty()) continue;
+        if (first == "binary" && offer_binary) {
+            binary = true;
+            continue; // not a command, nothing to answer
+        }
 
-    PROCESS_INFORMATION piProcInfo;
-    STARTUPINFO siStartInfo;
-    bool bSuccess = false;
+        Action action;
+        if (parse_command(line, action)) {
+            if (action.type == ACT_END) {
+                cost = action.cost;
+                break;
+            }
+            env.apply(action);
+        }
 
-    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
-    ZeroMemory(&siStartInfo, sizeof(STARTUPINFO));
+        // Send percepts
+        input.clear();
+        if (binary) append_percepts_binary(input, env.observe());
+        else append_percepts_text(input, env.observe());
+        agent.send(input);
+    }
 
-    siStartInfo.cb = sizeof(STARTUPINFO);
-    siStartInfo.hStdError = hChildStd_OUT_Wr;
-    siStartInfo.hStdOutput = hChildStd_OUT_Wr;
-    siStartInfo.hStdInput = hChildStd_IN_Rd;
-    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+    result.time = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    result.cost = cost;
+    result.moves = env.moves;
+    return result;
+}
 
-    string cmd = algo_name + ".exe";
+// run the agent binary for one game; the process starts up while the header is
+// on its way, so the time includes the startup
+EpisodeResult run_algo(const string& algo_name, int variant, const MapData& map) {
+    AgentProcess agent;
+    if (!agent.start(algo_name, collect_counters, false)) return EpisodeResult();
+    LineBuffer output;
+    EpisodeResult result = play_wire(agent, output, variant, map);
+    if (collect_counters) parse_counters_json(agent.read_errors(), result.counters);
+    agent.finish();
+    return result;
+}
 
-    bSuccess = CreateProcess(NULL,
-                             (LPSTR)cmd.c_str(),
-                             NULL,
-                             NULL,
-                             TRUE,
-                             0,
-                             NULL,
-                             NULL,
-                             &siStartInfo,
-                             &piProcInfo);
+// A warm agent process for --session: started on first use, then kept for every
+// episode its worker plays with that algorithm. Startup, up to the agent's
+// "ready" line, is timed apart from the episodes
+struct AgentSession {
+    AgentProcess process;
+    LineBuffer output, errors;
+    bool running = false;
+    int starts = 0;
+    double startup_time = 0.0;     // seconds, summed over starts
+
+    bool ensure_started(const string& algo_name) {
+        if (running) return true;
+        process = AgentProcess();
+        output = LineBuffer();
+        errors = LineBuffer();
+        auto start_time = chrono::steady_clock::now();
+        if (!process.start(algo_name, collect_counters, true)) return false;
+        string_view line;
+        if (!output.next_line(process, line) || line != "ready") { process.finish(); return false; }
+        startup_time += chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        starts++;
+        running = true;
+        return true;
+    }
 
-    if (!bSuccess) {
-        return {-2, 0.0};
+    void stop() {
+        if (running) process.finish(); // closing its input ends the session
+        running = false;
     }
 
-    CloseHandle(hChildStd_OUT_Wr);
-    CloseHandle(hChildStd_IN_Rd);
+    EpisodeResult play(const string& algo_name, int variant, const MapData& map) {
+        if (!ensure_started(algo_name)) return EpisodeResult();
+        EpisodeResult result = play_wire(process, output, variant, map);
+        string_view line;
+        if (collect_counters && result.cost != -2 && errors.next_line(process, line, true)) parse_counters_json(line, result.counters);
+        if (result.cost == -2) stop(); // the agent died or broke the protocol: start a new one next time
+        return result;
+    }
+};
 
+// play the agent in this process through its step() interface
+template <typename Agent>
+EpisodeResult run_inprocess(Agent& agent, int variant, const MapData& map) {
     auto start_time = chrono::steady_clock::now();
 
-    int gx = map.gollum.first, gy = map.gollum.second;
-    string input = to_string(variant) + "\n" + to_string(gx) + " " + to_string(gy) + "\n";
-    DWORD dwWritten;
-    WriteFile(hChildStd_IN_Wr, input.c_str(), (DWORD)input.size(), &dwWritten, NULL);
-
-    int r_perc = (variant == 1) ? 1 : 2;
-    vector<Percept> percepts = get_percepts(0, 0, r_perc, false, false, map, false);
-    input = to_string(percepts.size()) + "\n";
-    for (const auto& p : percepts) {
-        input += to_string(p.x) + " " + to_string(p.y) + " " + p.t + "\n";
+    Environment env(map, grid_size, variant);
+    agent.start(variant, map.gollum.first, map.gollum.second);
+    Action action = agent.step(env.observe());
+    while (action.type != ACT_END) {
+        env.apply(action);
+        action = agent.step(env.observe());
     }
-    WriteFile(hChildStd_IN_Wr, input.c_str(), (DWORD)input.size(), &dwWritten, NULL);
 
-    int curx = 0, cury = 0;
-    bool ring = false, mith = false, have_mount = false, reached_gollum = false;
-    int moves = 0;
+    EpisodeResult result;
+    result.time = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    result.cost = action.cost;
+    result.moves = env.moves;
+    result.counters = agent.counters;
+    return result;
+}
 
-    string output_buffer;
-    char buffer[1024];
-    int cost = -2;
-    bool done = false;
+// linked-in agents; the default size gets the fixed-size specialization
+template <int SIZE>
+EpisodeResult run_linked(const string& algo_name, int variant, const MapData& map) {
+    if (algo_name == "astar") {
+        AstarAgent<SIZE> agent(grid_size);
+        return run_inprocess(agent, variant, map);
+    }
+    BacktrackingAgent<SIZE> agent(grid_size);
+    return run_inprocess(agent, variant, map);
+}
 
-    while (!done) {
-        DWORD dwRead;
-        BOOL bRead = ReadFile(hChildStd_OUT_Rd, buffer, sizeof(buffer) - 1, &dwRead, NULL);
-        if (!bRead || dwRead == 0) break;
-        buffer[dwRead] = '\0';
-        output_buffer += buffer;
-
-        size_t pos;
-        while ((pos = output_buffer.find('\n')) != string::npos) {
-            string line = output_buffer.substr(0, pos);
-            output_buffer = output_buffer.substr(pos + 1);
-
-            if (line.empty()) continue;
-
-            istringstream iss(line);
-            string cmd;
-            iss >> cmd;
-
-            if (cmd == "m") {
-                int nx, ny;
-                iss >> nx >> ny;
-                curx = nx;
-                cury = ny;
-                moves++;
-                if (make_pair(curx, cury) == map.mithril) mith = true;
-                if (make_pair(curx, cury) == map.gollum) reached_gollum = true;
-            } else if (cmd == "r") {
-                ring = true;
-            } else if (cmd == "rr") {
-                ring = false;
-            } else if (cmd == "e") {
-                iss >> cost;
-                done = true;
-                break;
-            }
+// session: the worker's warm process for this algorithm, nullptr to start one per episode
+EpisodeResult run_episode(const string& algo_name, int variant, const MapData& map, bool spawn, AgentSession* session) {
+    if (session) return session->play(algo_name, variant, map);
+    if (spawn) return run_algo(algo_name, variant, map);
+    if (grid_size == DEFAULT_GRID_SIZE) return run_linked<DEFAULT_GRID_SIZE>(algo_name, variant, map);
+    return run_linked<0>(algo_name, variant, map);
+}
 
-            // Send percepts
-            percepts = get_percepts(curx, cury, r_perc, ring, mith, map, have_mount);
-            input = to_string(percepts.size()) + "\n";
-            for (const auto& p : percepts) {
-                input += to_string(p.x) + " " + to_string(p.y) + " " + p.t + "\n";
-            }
-            if (reached_gollum && !have_mount && curx == gx && cury == gy) {
-                have_mount = true;
-                int mdx = map.mount.first, mdy = map.mount.second;
-                input += to_string(mdx) + " " + to_string(mdy) + "\n";
-            }
-            WriteFile(hChildStd_IN_Wr, input.c_str(), (DWORD)input.size(), &dwWritten, NULL);
-        }
+// Log-bucketed quantile sketch: a value lands in bucket ceil(log_GAMMA(value)),
+// so every quantile comes back within 2% of the true value. Sketches merge by
+// adding bucket counts, whatever the number of values behind them.
+struct QuantileSketch {
+    static constexpr double ACCURACY = 0.02;
+    static constexpr double MIN_VALUE = 1e-9;  // smaller values share the first bucket
+    static constexpr int BUCKETS = 1024;       // up to about 1e8 seconds
+    array<long long, BUCKETS> counts{};
+    long long total = 0;
+
+    static double gamma() { return (1 + ACCURACY) / (1 - ACCURACY); }
+
+    void add(double value) {
+        int bucket = 0;
+        if (value > MIN_VALUE) bucket = min(BUCKETS - 1, (int)ceil(log(value / MIN_VALUE) / log(gamma())));
+        counts[bucket]++;
+        total++;
     }
 
-    double exec_time = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    void merge(const QuantileSketch& other) {
+        for (int b = 0; b < BUCKETS; b++) counts[b] += other.counts[b];
+        total += other.total;
+    }
 
-    CloseHandle(hChildStd_IN_Wr);
-    CloseHandle(hChildStd_OUT_Rd);
-    CloseHandle(piProcInfo.hProcess);
-    CloseHandle(piProcInfo.hThread);
+    // value at quantile q in [0, 1]: the middle of the bucket holding it
+    double quantile(double q) const {
+        if (total == 0) return 0.0;
+        long long rank = (long long)(q * (total - 1));
+        long long seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen > rank) return b == 0 ? MIN_VALUE : MIN_VALUE * 2 * pow(gamma(), b) / (gamma() + 1);
+        }
+        return 0.0;
+    }
+};
 
-    return {cost, exec_time};
-}
+// Running totals for one algorithm and variant: Welford mean/variance and a
+// quantile sketch for the times. Memory does not grow with the number of episodes.
+struct StatsAccumulator {
+    long long count = 0;          // episodes that ran (result != -2)
+    double mean = 0.0, m2 = 0.0;  // of the times
+    QuantileSketch times;
+    int wins = 0, losses = 0;
+    int losses_solvable = 0;
+    double ratio_sum = 0.0;
+    int ratio_count = 0;
+    AgentCounters counter_sums;
+
+    // optimal: the oracle's cost for the map, -1 when it is unsolvable
+    void add(const EpisodeResult& result, int optimal) {
+        if (result.cost == -2) return;
+        count++;
+        double delta = result.time - mean;
+        mean += delta / count;
+        m2 += delta * (result.time - mean);
+        times.add(result.time);
+        if (result.cost >= 0) ++wins;
+        else if (result.cost == -1) ++losses;
+        if (result.cost >= 0 && optimal > 0) { ratio_sum += (double)result.moves / optimal; ratio_count++; }
+        if (result.cost == -1 && optimal >= 0) losses_solvable++;
+        for (const CounterField& field : COUNTER_FIELDS) counter_sums.*field.member += result.counters.*field.member;
+    }
 
-void print_map(const MapData& map) {
-    vector<vector<char>> grid(N, vector<char>(N, '.'));
-    grid[0][0] = 'F';
-    grid[map.gollum.first][map.gollum.second] = 'G';
-    grid[map.mount.first][map.mount.second] = 'M';
-    grid[map.mithril.first][map.mithril.second] = 'C';
-    for (auto& e : map.enemies) {
-        int ex, ey; char et;
-        tie(ex, ey, et) = e;
-        grid[ex][ey] = et;
-    }
-    cout << "Map:" << endl;
-    for (auto& row : grid) {
-        for (char c : row) cout << c << " ";
-        cout << endl;
+    // combine with another worker's totals (Chan et al. for mean and variance)
+    void merge(const StatsAccumulator& other) {
+        if (other.count == 0) return;
+        long long n = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / n;
+        m2 += other.m2 + delta * delta * ((double)count * other.count / n);
+        count = n;
+        times.merge(other.times);
+        wins += other.wins;
+        losses += other.losses;
+        losses_solvable += other.losses_solvable;
+        ratio_sum += other.ratio_sum;
+        ratio_count += other.ratio_count;
+        for (const CounterField& field : COUNTER_FIELDS) counter_sums.*field.member += other.counter_sums.*field.member;
     }
-    cout << endl;
-}
+};
 
 struct Stats {
     double mean_time = 0.0;
-    double median_time = 0.0;
-    double mode_time = 0.0;
     double stdev_time = 0.0;
+    double p50_time = 0.0, p90_time = 0.0, p99_time = 0.0, p999_time = 0.0;
     int wins = 0;
     int losses = 0;
     double percent_win = 0.0;
     double percent_loss = 0.0;
+    double optimal_ratio = 0.0;  // mean of moves / oracle optimum over the wins
+    int losses_solvable = 0;     // losses on maps the oracle solves
+    double counter_means[size(COUNTER_FIELDS)] = {}; // per episode, with --counters
 };
 
-Stats compute_stats(const vector<pair<int, double>>& res_list) {
-    vector<int> costs;
-    vector<double> times;
-    for (auto& p : res_list) {
-        if (p.first != -2) {
-            costs.push_back(p.first);
-            times.push_back(p.second);
-        }
-    }
+Stats compute_stats(const StatsAccumulator& acc) {
     Stats stats;
-    if (times.empty()) return stats;
-
-    stats.wins = 0;
-    stats.losses = 0;
-    for (int c : costs) {
-        if (c >= 0) ++stats.wins;
-        else if (c == -1) ++stats.losses;
-    }
-    int n = times.size();
-    stats.percent_win = 100.0 * stats.wins / n;
-    stats.percent_loss = 100.0 * stats.losses / n;
-
-    double sum = 0.0;
-    for (double t : times) sum += t;
-    stats.mean_time = sum / n;
-
-    double var = 0.0;
-    for (double t : times) var += (t - stats.mean_time) * (t - stats.mean_time);
-    if (n > 1) stats.stdev_time = sqrt(var / (n - 1));
-    else stats.stdev_time = 0.0;
-
-    vector<double> sorted_times = times;
-    sort(sorted_times.begin(), sorted_times.end());
-    if (n % 2 == 1) stats.median_time = sorted_times[n / 2];
-    else stats.median_time = (sorted_times[n / 2 - 1] + sorted_times[n / 2]) / 2.0;
-
-    map<double, int> freq;
-    for (double t : times) ++freq[t];
-    int max_freq = 0;
-    double mode = 0.0;
-    for (auto& kv : freq) {
-        if (kv.second > max_freq) {
-            max_freq = kv.second;
-            mode = kv.first;
-        }
-    }
-    if (max_freq > 1) stats.mode_time = mode;
-    else stats.mode_time = 0.0;
-
+    if (acc.count == 0) return stats;
+    stats.wins = acc.wins;
+    stats.losses = acc.losses;
+    stats.percent_win = 100.0 * stats.wins / acc.count;
+    stats.percent_loss = 100.0 * stats.losses / acc.count;
+    stats.mean_time = acc.mean;
+    stats.stdev_time = acc.count > 1 ? sqrt(acc.m2 / (acc.count - 1)) : 0.0;
+    stats.p50_time = acc.times.quantile(0.5);
+    stats.p90_time = acc.times.quantile(0.9);
+    stats.p99_time = acc.times.quantile(0.99);
+    stats.p999_time = acc.times.quantile(0.999);
+    if (acc.ratio_count > 0) stats.optimal_ratio = acc.ratio_sum / acc.ratio_count;
+    stats.losses_solvable = acc.losses_solvable;
+    for (size_t i = 0; i < size(COUNTER_FIELDS); i++) stats.counter_means[i] = (double)(acc.counter_sums.*COUNTER_FIELDS[i].member) / acc.count;
     return stats;
 }
 
 void print_stats(const string& key, const Stats& stats) {
     cout << "Stats for " << key << ":" << endl;
     cout << "mean_time: " << stats.mean_time << endl;
-    cout << "median_time: " << stats.median_time << endl;
-    cout << "mode_time: " << stats.mode_time << endl;
     cout << "stdev_time: " << stats.stdev_time << endl;
+    cout << "p50_time: " << stats.p50_time << endl;
+    cout << "p90_time: " << stats.p90_time << endl;
+    cout << "p99_time: " << stats.p99_time << endl;
+    cout << "p99.9_time: " << stats.p999_time << endl;
     cout << "wins: " << stats.wins << endl;
     cout << "losses: " << stats.losses << endl;
     cout << "percent_win: " << stats.percent_win << endl;
     cout << "percent_loss: " << stats.percent_loss << endl;
+    cout << "optimal_ratio: " << stats.optimal_ratio << endl;
+    cout << "losses_solvable: " << stats.losses_solvable << endl;
+    if (collect_counters) {
+        for (size_t i = 0; i < size(COUNTER_FIELDS); i++) cout << "mean_" << COUNTER_FIELDS[i].name << ": " << stats.counter_means[i] << endl;
+    }
     cout << endl;
 }
 
-int main() {
-    map<string, vector<pair<int, double>>> results;
-    vector<MapData> impossible_maps;
+const char* ALGOS[2] = {"astar", "backtracking"};
+const char* ALGO_KEYS[2] = {"astar", "back"};
 
-    for (int i = 0; i < NUM_TESTS; ++i) {
-        MapData map = generate_map();
-        for (int variant : {1, 2}) {
-            auto res_a = run_algo("astar", variant, map);
-            auto res_b = run_algo("backtracking", variant, map);
-            string key_a = "astar_v" + to_string(variant);
-            string key_b = "back_v" + to_string(variant);
-            results[key_a].push_back(res_a);
-            results[key_b].push_back(res_b);
-            if (res_a.first == -1 && res_b.first == -1) {
-                impossible_maps.push_back(map);
+// FNV-1a over a whole file, 0 if it cannot be read
+uint64_t file_hash(const string& path) {
+    MappedFile file;
+    if (!file.open(path)) return 0;
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < file.size; i++) { h ^= file.data[i]; h *= 0x100000001b3ull; }
+    return h;
+}
+
+// headers a linked agent is compiled from, [algorithm]
+const vector<string> AGENT_SOURCES[2] = {
+    {"astar_agent.h", "agent.h", "grid.h", "bitboard.h"},
+    {"backtracking_agent.h", "agent.h", "grid.h"},
+};
+
+string directory_of(const string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// A linked agent is keyed by its headers, so changing one agent leaves the other's
+// episodes cached. They are read from where this file was compiled, or else from next
+// to the binary. 0 with the reason in `why` when a header cannot be read or is newer
+// than this binary, which was then built from other sources
+uint64_t linked_agent_hash(int algo, const string& binary, string& why) {
+    error_code ec;
+    auto built = filesystem::last_write_time(binary, ec);
+    if (ec) { why = "cannot find the tester binary " + binary; return 0; }
+    string dir = directory_of(__FILE__);
+    if (file_hash(dir + AGENT_SOURCES[algo][0]) == 0) dir = directory_of(binary);
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const string& name : AGENT_SOURCES[algo]) {
+        uint64_t part = file_hash(dir + name);
+        if (part == 0) { why = "cannot read " + dir + name; return 0; }
+        if (filesystem::last_write_time(dir + name, ec) > built || ec) { why = dir + name + " is newer than " + binary + ", rebuild the tester"; return 0; }
+        h = (h ^ part) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+string hex64(uint64_t value) {
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", (unsigned long long)value);
+    return text;
+}
+
+// Outcomes of earlier runs (--cache=FILE), one line per episode, only ever appended:
+//   <algo> <agent hash> <map hash> <variant> <mode> <cost> <moves> <time> <counters JSON or ->
+// An episode is reused when the agent, the map, the variant and the mode (linked,
+// spawn or session, and the wire) all match; the last line for a key wins. A spawned
+// agent is hashed by its whole binary, a linked one by its headers, so changing one
+// agent only invalidates its lines
+struct ResultCache {
+    struct Entry { EpisodeResult result; bool with_counters; };
+    unordered_map<string, Entry> entries;
+    FILE* out = nullptr;
+    mutex out_mutex;
+    uint64_t agent_hash[2] = {};    // [algorithm]; 0: the agent could not be hashed, not cached
+    string mode;
+    bool fresh = false;             // --fresh: measure everything again, still append the results
+    atomic<int> hits{0}, stored{0};
+
+    string key(int algo, uint64_t map_key, int variant) const {
+        return string(ALGOS[algo]) + ' ' + hex64(agent_hash[algo]) + ' ' + hex64(map_key) + ' ' + to_string(variant) + ' ' + mode;
+    }
+
+    // load the file and keep it open for appending; an empty string on success
+    string open(const string& path) {
+        ifstream in(path);
+        string line;
+        while (getline(in, line)) {
+            // the key is the first five words, the outcome follows
+            size_t pos = 0;
+            for (int i = 0; i < 5; i++) next_word(line, pos);
+            string_view rest = string_view(line).substr(pos);
+            size_t at = 0;
+            Entry entry;
+            string_view cost = next_word(rest, at), moves = next_word(rest, at), time = next_word(rest, at), counters = next_word(rest, at);
+            if (!parse_int(cost, entry.result.cost) || !parse_int(moves, entry.result.moves) || counters.empty()) continue; // torn or foreign line
+            entry.result.time = strtod(string(time).c_str(), nullptr);
+            entry.with_counters = counters != "-";
+            if (entry.with_counters) parse_counters_json(counters, entry.result.counters);
+            entries[line.substr(0, pos)] = entry;
+        }
+        out = fopen(path.c_str(), "a");
+        if (!out) return "cannot append to " + path;
+        return "";
+    }
+
+    bool lookup(int algo, uint64_t map_key, int variant, EpisodeResult& result) {
+        if (fresh || agent_hash[algo] == 0) return false;
+        auto it = entries.find(key(algo, map_key, variant));
+        if (it == entries.end() || (collect_counters && !it->second.with_counters)) return false;
+        result = it->second.result;
+        hits++;
+        return true;
+    }
+
+    void store(int algo, uint64_t map_key, int variant, const EpisodeResult& result) {
+        if (agent_hash[algo] == 0 || result.cost == -2) return;
+        string line = key(algo, map_key, variant) + ' ';
+        append_int(line, result.cost); line += ' ';
+        append_int(line, result.moves);
+        char time[32];
+        snprintf(time, sizeof(time), " %.9g ", result.time);
+        line += time;
+        if (collect_counters) append_counters_json(line, result.counters);
+        else line += '-';
+        line += '\n';
+        lock_guard<mutex> lock(out_mutex);
+        fputs(line.c_str(), out);
+        stored++;
+    }
+
+    ~ResultCache() { if (out) fclose(out); }
+};
+
+// maps of a run: generated from the seed, or replayed from a memory-mapped corpus
+struct MapSource {
+    vector<MapData> generated;
+    MapCorpus corpus;
+    bool from_corpus = false;
+
+    int count() const { return from_corpus ? (int)corpus.count() : (int)generated.size(); }
+    MapData get(int index) const { return from_corpus ? corpus.get(index) : generated[index]; }
+};
+
+// what one worker collected; workers merge at the end, so only counts and the
+// list of impossible maps are independent of how maps were spread over workers
+struct RunTotals {
+    StatsAccumulator stats[2][2];   // [algorithm][variant - 1]
+    int both_lost_solvable = 0;     // episodes lost by both agents on solvable maps
+    vector<int> impossible;         // maps the oracle cannot solve
+    int starts[2] = {};             // --session: agent processes started, [algorithm]
+    double startup_time[2] = {};    // and their summed startup seconds
+
+    void merge(const RunTotals& other) {
+        for (int a = 0; a < 2; a++) for (int v = 0; v < 2; v++) stats[a][v].merge(other.stats[a][v]);
+        for (int a = 0; a < 2; a++) { starts[a] += other.starts[a]; startup_time[a] += other.startup_time[a]; }
+        both_lost_solvable += other.both_lost_solvable;
+        impossible.insert(impossible.end(), other.impossible.begin(), other.impossible.end());
+    }
+};
+
+// one JSON line per episode on stderr, in the order the workers finish them
+mutex record_mutex;
+void write_episode_record(int map_index, int variant, const string& algo, const EpisodeResult& result, int optimal) {
+    string line = "{\"map\":";
+    append_int(line, map_index);
+    line += ",\"variant\":"; append_int(line, variant);
+    line += ",\"algo\":\"" + algo + "\",\"cost\":"; append_int(line, result.cost);
+    line += ",\"moves\":"; append_int(line, result.moves);
+    line += ",\"optimal\":"; append_int(line, optimal);
+    line += ",\"time\":" + to_string(result.time) + ",\"counters\":";
+    append_counters_json(line, result.counters);
+    line += "}\n";
+    lock_guard<mutex> lock(record_mutex);
+    cerr << line;
+}
+
+// run every map on `jobs` worker threads, each taking the next unclaimed map and
+// playing both agents in both variants on it
+// cache: reuse and record outcomes (--cache), nullptr to play every episode
+RunTotals run_maps(const MapSource& maps, int num_maps, int jobs, bool spawn, ResultCache* cache) {
+    atomic<int> next(0);
+    vector<RunTotals> totals(jobs);
+    auto worker = [&](RunTotals& mine) {
+        Oracle oracle;
+        AgentSession sessions[2];
+        while (true) {
+            int i = next++;
+            if (i >= num_maps) break;
+            MapData map = maps.get(i);
+            int optimal = oracle.solve(map, grid_size); // full-knowledge optimum, -1 if unsolvable
+            if (optimal < 0) mine.impossible.push_back(i);
+            uint64_t map_key = cache ? map_hash(map, grid_size) : 0;
+            for (int variant : {1, 2}) {
+                EpisodeResult result[2];
+                for (int a = 0; a < 2; a++) {
+                    if (!cache || !cache->lookup(a, map_key, variant, result[a])) {
+                        result[a] = run_episode(ALGOS[a], variant, map, spawn, use_sessions ? &sessions[a] : nullptr);
+                        if (cache) cache->store(a, map_key, variant, result[a]);
+                    }
+                    mine.stats[a][variant - 1].add(result[a], optimal);
+                    if (collect_counters) write_episode_record(i, variant, ALGOS[a], result[a], optimal);
+                }
+                if (result[0].cost == -1 && result[1].cost == -1 && optimal >= 0) mine.both_lost_solvable++;
+            }
+        }
+        for (int a = 0; a < 2; a++) {
+            sessions[a].stop();
+            mine.starts[a] = sessions[a].starts;
+            mine.startup_time[a] = sessions[a].startup_time;
+        }
+    };
+    vector<thread> workers;
+    for (int w = 1; w < jobs; ++w) workers.emplace_back(worker, ref(totals[w]));
+    worker(totals[0]);
+    for (auto& t : workers) t.join();
+
+    for (int w = 1; w < jobs; ++w) totals[0].merge(totals[w]);
+    sort(totals[0].impossible.begin(), totals[0].impossible.end());
+    return totals[0];
+}
+
+int main(int argc, char** argv) {
+    // --jobs=K worker threads (default: all cores), --seed=S reproduces a previous run,
+    // --maps=K number of maps, --corpus=FILE replays maps written by mapgen,
+    // --spawn runs the agent binaries instead of the linked-in agents, --session runs
+    // them as warm processes that play many episodes each, --wire=text keeps them
+    // on the text protocol, --counters adds the agents' work counters
+    // (a JSON line per episode on stderr, means in the stats);
+    // --cache=FILE reuses episodes recorded there for the same agent binary, map and
+    // mode and appends new ones, --fresh measures everything again;
+    // --size and the enemy counts (see parse_map_option) shape generated maps
+    int jobs = max(1u, thread::hardware_concurrency());
+    unsigned seed = random_device{}();
+    int num_maps = NUM_TESTS;
+    bool maps_given = false;
+    string corpus_path;
+    bool spawn = false;
+    MapGenerator generator;
+    string cache_path;
+    bool fresh = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (parse_map_option(arg, generator.config)) continue;
+        if (arg.rfind("--jobs=", 0) == 0) jobs = max(1, stoi(arg.substr(7)));
+        else if (arg.rfind("--seed=", 0) == 0) seed = (unsigned)stoul(arg.substr(7));
+        else if (arg.rfind("--maps=", 0) == 0) { num_maps = max(1, stoi(arg.substr(7))); maps_given = true; }
+        else if (arg.rfind("--corpus=", 0) == 0) corpus_path = arg.substr(9);
+        else if (arg == "--spawn") spawn = true;
+        else if (arg == "--session") spawn = use_sessions = true;
+        else if (arg == "--wire=text") offer_binary = false;
+        else if (arg == "--counters") collect_counters = true;
+        else if (arg.rfind("--cache=", 0) == 0) cache_path = arg.substr(8);
+        else if (arg == "--fresh") fresh = true;
+    }
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN); // an agent that exits early must not kill the tester
+#endif
+
+    MapSource maps;
+    if (!corpus_path.empty()) {
+        string error = maps.corpus.open(corpus_path);
+        if (error.empty() && (maps.corpus.grid_size() < 2 || maps.corpus.grid_size() > MAX_GRID_SIZE)) error = corpus_path + ": unsupported grid size";
+        if (!error.empty()) {
+            cerr << error << endl;
+            return 1;
+        }
+        maps.from_corpus = true;
+        grid_size = maps.corpus.grid_size();
+        if (!maps_given || num_maps > maps.count()) num_maps = maps.count();
+        cout << "corpus: " << corpus_path << " (" << num_maps << " maps), jobs: " << jobs << endl << endl;
+    } else {
+        string error = generator.check();
+        if (!error.empty()) {
+            cerr << error << endl;
+            return 1;
+        }
+        grid_size = generator.config.size;
+        cout << "seed: " << seed << ", jobs: " << jobs << endl << endl;
+        // maps are generated up front in order, before any agent runs
+        mt19937 gen(seed);
+        maps.generated.resize(num_maps);
+        for (int i = 0; i < num_maps; ++i) {
+            if (!generator.generate(gen, maps.generated[i])) {
+                cerr << "map " << i << ": the enemies leave no room for the key items" << endl;
+                return 1;
             }
         }
     }
 
-    for (auto& kv : results) {
-        Stats stats = compute_stats(kv.second);
-        print_stats(kv.first, stats);
+    unique_ptr<ResultCache> cache;
+    if (!cache_path.empty()) {
+        cache = make_unique<ResultCache>();
+        string error = cache->open(cache_path);
+        if (!error.empty()) {
+            cerr << error << endl;
+            return 1;
+        }
+        cache->fresh = fresh;
+        cache->mode = !spawn ? "linked" : use_sessions ? "session" : "spawn";
+        if (spawn) cache->mode += offer_binary ? "-binary" : "-text";
+        for (int a = 0; a < 2; a++) {
+            string why = "cannot read " + agent_binary_path(ALGOS[a]);
+            cache->agent_hash[a] = spawn ? file_hash(agent_binary_path(ALGOS[a])) : linked_agent_hash(a, argv[0], why);
+            if (cache->agent_hash[a] == 0) cerr << "warning: " << ALGOS[a] << " episodes are not cached: " << why << endl;
+        }
     }
 
-    cout << "\nImpossible maps:" << endl;
-    for (const auto& imp_map : impossible_maps) {
-        print_map(imp_map);
+    RunTotals totals = run_maps(maps, num_maps, jobs, spawn, cache.get());
+
+    for (int a = 0; a < 2; a++) {
+        for (int variant : {1, 2}) {
+            print_stats(string(ALGO_KEYS[a]) + "_v" + to_string(variant), compute_stats(totals.stats[a][variant - 1]));
+        }
+    }
+
+    // session episode times leave out process startup, which is reported here instead
+    if (use_sessions) {
+        for (int a = 0; a < 2; a++) {
+            double mean = totals.starts[a] > 0 ? totals.startup_time[a] / totals.starts[a] : 0.0;
+            cout << ALGO_KEYS[a] << "_startup_time: " << mean << " (" << totals.starts[a] << " processes)" << endl;
+        }
     }
+    if (cache) cout << "cache: " << cache->hits << " episodes reused, " << cache->stored << " recorded in " << cache_path << endl << endl;
+    cout << "Lost by both agents although solvable (episodes): " << totals.both_lost_solvable << endl;
+    cout << "\nImpossible maps:" << endl;
+    for (int i : totals.impossible) print_map(maps.get(i), grid_size);
 
     return 0;
-}
\ No newline at end of file
+}